@@ -0,0 +1,132 @@
+#include "search-strategies.h"
+#include "flat-state-set.h"
+#include "node-arena.h"
+#include "memusage.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace {
+
+struct OpenEntry {
+	SearchState state;
+	NodeId id;
+	int g;
+};
+
+// budgets are checked once per this many expansions, reading RSS is not free
+constexpr int budget_check_period = 256;
+
+}
+
+AnytimeAStarSearch::AnytimeAStarSearch(
+        std::unique_ptr<AStarHeuristicItf> &&heuristic,
+        size_t mem_limit,
+        std::chrono::milliseconds time_limit,
+        double initial_weight
+    ) :
+        heuristic_(std::move(heuristic)),
+        mem_limit_(mem_limit),
+        time_limit_(time_limit),
+        initial_weight_(std::max(initial_weight, 1.0)) {
+	; // just for initializer list
+}
+
+std::vector<SearchAction> AnytimeAStarSearch::solve(const SearchState &init_state) {
+	closed_stats_ = {};
+	if (init_state.isFinal())
+		return {};
+
+	auto deadline = std::chrono::steady_clock::time_point::max();
+	if (time_limit_.count() > 0)
+		deadline = std::chrono::steady_clock::now() + time_limit_;
+
+	std::vector<SearchAction> best;
+	double weight = initial_weight_;
+	while (true) {
+		size_t max_length = best.empty() ? std::numeric_limits<size_t>::max() : best.size();
+		RunResult_ result = weightedRun_(init_state, weight, max_length, deadline);
+		closed_stats_ += result.closed_stats;
+		if (!result.solution.empty())
+			best = std::move(result.solution);
+
+		// with weight 1 the run is plain A*, there is nothing more to tighten
+		if (result.out_of_budget || weight == 1.0)
+			break;
+
+		// halve the distance to plain A*, the last few steps would barely differ
+		weight = 1.0 + (weight - 1.0) / 2;
+		if (weight < 1.1)
+			weight = 1.0;
+	}
+
+	return best;
+}
+
+// Looks for a solution shorter than max_length
+AnytimeAStarSearch::RunResult_ AnytimeAStarSearch::weightedRun_(
+        const SearchState &init_state,
+        double weight,
+        size_t max_length,
+        std::chrono::steady_clock::time_point deadline
+    ) const {
+	FlatStateSet closed(mem_limit_ / 2);
+	BucketOpenList<OpenEntry> open(TieBreak::LowH);
+	NodeArena tree;
+
+	open.push(0, 0, {init_state, tree.addRoot(), 0});
+
+	MoveBuffer actions; // reused for every expansion
+	int until_budget_check = budget_check_period;
+	auto old_memory = getCurrentRSS();
+
+	while (!open.empty())
+	{
+		OpenEntry current = open.pop();
+
+		// its children could not be a part of a shorter solution
+		if (static_cast<size_t>(current.g) + 1 >= max_length)
+			continue;
+
+		if (--until_budget_check == 0)
+		{
+			until_budget_check = budget_check_period;
+			if (std::chrono::steady_clock::now() >= deadline)
+				return {{}, true, closed.stats()};
+
+			// stop well before the memory watcher aborts everything, the best solution
+			// would be lost then: taken memory + 4 * growth since the last check
+			auto taken_memory = getCurrentRSS();
+			size_t growth = taken_memory > old_memory ? taken_memory - old_memory : 0;
+			if (growth * 5 + taken_memory > mem_limit_)
+				return {{}, true, closed.stats()};
+			old_memory = taken_memory;
+		}
+
+		current.state.actions(actions);
+		for (auto move : actions)
+		{
+			SearchState new_state = SearchAction(move).execute(current.state);
+			if (closed.insert(new_state.packed()))
+			{
+				if (new_state.isDeadEnd())
+					continue; // provably unsolvable, not worth queueing
+
+				NodeId new_id = tree.add(current.id, move);
+				if (new_state.isFinal())
+					return {tree.pathTo(new_id), false, closed.stats()};
+
+				int g = current.g + 1;
+				double f = g + weight * compute_heuristic(new_state, *heuristic_);
+				open.push(f, g, {new_state, new_id, g});
+			}
+			else if (closed.full())
+			{
+				return {{}, true, closed.stats()}; // the closed list ran out of memory
+			}
+		}
+	}
+
+	return {{}, false, closed.stats()};
+}
@@ -0,0 +1,79 @@
+#include "search-strategies.h"
+#include "flat-state-set.h"
+#include "node-arena.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct Candidate {
+	SearchState state;
+	NodeId parent;
+	PackedMove move;
+	double h;
+};
+
+struct BeamEntry {
+	SearchState state;
+	NodeId id;
+};
+
+}
+
+std::vector<SearchAction> BeamSearch::solve(const SearchState &init_state) {
+	closed_stats_ = {};
+	if (init_state.isFinal() || beam_width_ == 0)
+		return {};
+
+	NodeArena tree;
+	FlatStateSet kept;	  // every state which made it into some layer
+	FlatStateSet layer;	  // children of the current layer, to drop duplicates among them
+
+	std::vector<BeamEntry> beam{{init_state, tree.addRoot()}};
+	kept.insert(init_state.packed());
+
+	std::vector<Candidate> candidates;
+	MoveBuffer actions;
+
+	while (!beam.empty()) {
+		candidates.clear();
+		layer.clear();
+
+		for (const auto &entry : beam) {
+			entry.state.actions(actions);
+			for (auto move : actions) {
+				SearchState new_state = SearchAction(move).execute(entry.state);
+				auto packed = new_state.packed();
+				if (kept.contains(packed) || !layer.insert(packed))
+					continue;
+
+				if (new_state.isFinal()) {
+					closed_stats_ = kept.stats();
+					return tree.pathTo(tree.add(entry.id, move));
+				}
+				if (new_state.isDeadEnd())
+					continue;
+
+				double h = compute_heuristic(new_state, *heuristic_);
+				candidates.push_back({new_state, entry.id, move, h});
+			}
+		}
+
+		// the best beam_width candidates, earlier generated ones win ties
+		auto better = [](const Candidate &a, const Candidate &b) {return a.h < b.h;};
+		if (candidates.size() > beam_width_) {
+			std::stable_sort(candidates.begin(), candidates.end(), better);
+			candidates.erase(candidates.begin() + beam_width_, candidates.end());
+		}
+
+		beam.clear();
+		for (auto &candidate : candidates) {
+			kept.insert(candidate.state.packed());
+			beam.push_back({candidate.state, tree.add(candidate.parent, candidate.move)});
+		}
+	}
+
+	closed_stats_ = kept.stats();
+	return {};
+}
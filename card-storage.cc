@@ -1,5 +1,8 @@
 #include "card-storage.h"
 
+#include <algorithm>
+#include <cassert>
+
 bool operator== (const std::optional<Card> &lhs, const std::optional<Card> rhs) {
     if (lhs.has_value() && rhs.has_value()) {
         return *lhs == *rhs;
@@ -10,32 +13,14 @@ bool operator== (const std::optional<Card> &lhs, const std::optional<Card> rhs)
     }
 }
 
-bool HomeDestination::canSitOn(const Card &base, const Card &candidate) {
-	return candidate.color == base.color && candidate.value == base.value + 1;
-}
-
-bool HomeDestination::canAccept(const Card & card) const {
-    if (storage_.size() == 0)
-		return card.value == 1;
-    else
-		return canSitOn(*topCard(), card);
-}
-
 bool HomeDestination::acceptCard(const Card & card) {
 	auto move_ok = canAccept(card);
 	if (move_ok) 
-		storage_.push_back(card);
+		top_ = card;
 
 	return move_ok;
 }
 
-const std::optional<Card> HomeDestination::topCard() const {
-	if (storage_.size() > 0)
-		return storage_.back();
-	else
-		return std::nullopt;
-}
-
 bool operator< (const HomeDestination &lhs, const HomeDestination &rhs) {
     return lhs.topCard() < rhs.topCard();
 }
@@ -45,34 +30,39 @@ bool operator== (const HomeDestination &lhs, const HomeDestination &rhs) {
 }
 
 bool operator< (const WorkStack &lhs, const WorkStack &rhs) {
-    return lhs.storage_ < rhs.storage_;
+    auto lhs_cards = lhs.storage();
+    auto rhs_cards = rhs.storage();
+    return std::lexicographical_compare(lhs_cards.begin(), lhs_cards.end(), rhs_cards.begin(), rhs_cards.end());
 }
 
 bool operator== (const WorkStack &lhs, const WorkStack &rhs) {
-    return lhs.storage_ == rhs.storage_;
+    auto lhs_cards = lhs.storage();
+    auto rhs_cards = rhs.storage();
+    return lhs.size_ == rhs.size_ && std::equal(lhs_cards.begin(), lhs_cards.end(), rhs_cards.begin());
 }
 
 
 std::optional<Card> HomeDestination::getCard() {
-	auto card = storage_.back();
-	storage_.pop_back();
+	auto card = top_;
+	if (!card.has_value())
+		return std::nullopt;
+
+	if (card->value() == 1)
+		top_.reset();
+	else
+		top_ = Card(card->color(), card->value() - 1);
 	return card;
 }
 
 std::ostream& operator<< (std::ostream& os, const HomeDestination & hd) {
-	if (hd.storage_.size() == 0)
+	if (!hd.top_.has_value())
         os << "_"; 
     else
-        os << *hd.topCard();
+        os << *hd.top_;
 
     return os;
 }
 
-
-bool FreeCell::canAccept([[maybe_unused]] const Card & card) const {
-	return !cell_.has_value();
-}
-
 bool FreeCell::acceptCard(const Card & card) {
 	auto move_ok = canAccept(card);
     if (move_ok)
@@ -81,19 +71,6 @@ bool FreeCell::acceptCard(const Card & card) {
     return move_ok;
 }
 
-FreeCell & FreeCell::operator=(FreeCell &other) {
-	if (other.cell_.has_value())
-		cell_.emplace(*other.cell_);
-	else
-		cell_ = std::nullopt;
-
-	return *this;
-}
-
-const std::optional<Card> FreeCell::topCard() const {
-	return cell_;
-}
-
 std::optional<Card> FreeCell::getCard() {
 	auto card = std::move(cell_);
 	cell_.reset();
@@ -119,56 +96,34 @@ std::ostream& operator<< (std::ostream& os, const FreeCell & fc) {
     return os;
 }
 
-bool WorkStack::canSitOn(const Card &base, const Card &candidate) {
-	bool oppposing_render_color = render_color_map.at(candidate.color) != render_color_map.at(base.color);
-	bool one_less = candidate.value == base.value - 1;
-	return oppposing_render_color && one_less;
-}
-
-
-bool WorkStack::canAccept(const Card & card) const {
-    if (storage_.size() == 0)
-        return true;
-    else
-		return canSitOn(*topCard(), card);
-}
-
 bool WorkStack::acceptCard(const Card & card) {
 	auto move_ok = canAccept(card);
 	if (move_ok) 
-		storage_.push_back(card);
+		forceCard(card);
 
 	return move_ok;
 }
 
-const std::optional<Card> WorkStack::topCard() const {
-	if (storage_.size() > 0)
-		return storage_.back();
-	else
-		return std::nullopt;
-}
-
-
 std::optional<Card> WorkStack::getCard() {
-	if (storage_.size() > 0) {
-        auto card = storage_.back();
-        storage_.pop_back();
-		return card;
+	if (size_ > 0) {
+		return cards_[--size_];
 	} else {
 		return std::nullopt;
     }
 }
 
 void WorkStack::forceCard(const Card & card) {
-	storage_.push_back(card);
+	assert(size_ < max_stack_size);
+	cards_[size_++] = card;
 }
 
 std::ostream& operator<< (std::ostream& os, const WorkStack & stack) {
-	if (stack.storage_.size() == 0) {
+	auto cards = stack.storage();
+	if (cards.empty()) {
         os << "_"; 
     } else {
-        os << stack.storage_[0];
-        for (auto card_it = stack.storage_.begin() + 1; card_it != stack.storage_.end(); ++card_it) {
+        os << cards[0];
+        for (auto card_it = cards.begin() + 1; card_it != cards.end(); ++card_it) {
             os << " " << *card_it;
         }
     }
@@ -176,6 +131,46 @@ std::ostream& operator<< (std::ostream& os, const WorkStack & stack) {
     return os;
 }
 
-size_t WorkStack::nbCards() const {
-	return storage_.size();
+bool CardStorage::canAccept(const Card & card) const {
+    switch (kind_) {
+        case Kind::Home:
+            return static_cast<const HomeDestination *>(this)->canAccept(card);
+        case Kind::Stack:
+            return static_cast<const WorkStack *>(this)->canAccept(card);
+        default:
+            return static_cast<const FreeCell *>(this)->canAccept(card);
+    }
+}
+
+bool CardStorage::acceptCard(const Card & card) {
+    switch (kind_) {
+        case Kind::Home:
+            return static_cast<HomeDestination *>(this)->acceptCard(card);
+        case Kind::Stack:
+            return static_cast<WorkStack *>(this)->acceptCard(card);
+        default:
+            return static_cast<FreeCell *>(this)->acceptCard(card);
+    }
+}
+
+const std::optional<Card> CardStorage::topCard() const {
+    switch (kind_) {
+        case Kind::Home:
+            return static_cast<const HomeDestination *>(this)->topCard();
+        case Kind::Stack:
+            return static_cast<const WorkStack *>(this)->topCard();
+        default:
+            return static_cast<const FreeCell *>(this)->topCard();
+    }
+}
+
+std::optional<Card> CardStorage::getCard() {
+    switch (kind_) {
+        case Kind::Home:
+            return static_cast<HomeDestination *>(this)->getCard();
+        case Kind::Stack:
+            return static_cast<WorkStack *>(this)->getCard();
+        default:
+            return static_cast<FreeCell *>(this)->getCard();
+    }
 }
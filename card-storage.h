@@ -3,48 +3,107 @@
 
 #include "card.h"
 
+#include <array>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <optional>
 
+// A stack gets at most 8 cards during (easy) deal setup and then only grows
+// by a descending sequence, which can add at most 12 more cards on top of a King.
+inline constexpr int max_stack_size = 20;
 
+
+// Common interface of the storages. Instead of virtual functions, every storage remembers
+// its kind and the calls are dispatched on it. Without a vtable pointer the storages,
+// and thus whole game states, are trivially copyable.
 class CardStorage {
 public:
-	virtual bool canAccept(const Card & card) const = 0;
-    virtual bool acceptCard(const Card & card) = 0;
-    virtual const std::optional<Card> topCard() const = 0;
-    virtual std::optional<Card> getCard() = 0;
-	virtual ~CardStorage() {};
+	bool canAccept(const Card & card) const;
+    bool acceptCard(const Card & card);
+    const std::optional<Card> topCard() const;
+    std::optional<Card> getCard();
+
+protected:
+    enum class Kind : std::uint8_t {Home, Stack, FreeCell};
+    explicit CardStorage(Kind kind) : kind_(kind) {}
+
+private:
+    Kind kind_;
+};
+
+
+// Read-only view of a contiguous run of cards, bottom one first
+class CardRange {
+public:
+    CardRange(const Card *begin, const Card *end) : begin_(begin), end_(end) {}
+
+    const Card *begin() const {return begin_;}
+    const Card *end() const {return end_;}
+    size_t size() const {return end_ - begin_;}
+    bool empty() const {return begin_ == end_;}
+    const Card &operator[](size_t i) const {return begin_[i];}
+
+private:
+    const Card *begin_;
+    const Card *end_;
 };
 
 
-class HomeDestination : public CardStorage {
+// The queries used by move generation are defined inline, so that they are inlined
+// whenever the concrete storage type is known.
+
+// Only the top card is kept, all the lower ones of the same color are implied by it.
+class HomeDestination final : public CardStorage {
 public:
-	static bool canSitOn(const Card &base, const Card &candidate);
-	bool canAccept(const Card & card) const override;
-    bool acceptCard(const Card & card) override;
-    const std::optional<Card> topCard() const override;
-    std::optional<Card> getCard() override;
+	HomeDestination() : CardStorage(Kind::Home) {}
+
+	static bool canSitOn(const Card &base, const Card &candidate) {
+		return candidate.color() == base.color() && candidate.value() == base.value() + 1;
+	}
+	bool canAccept(const Card & card) const {
+		if (!top_.has_value())
+			return card.value() == 1;
+		else
+			return canSitOn(*top_, card);
+	}
+    bool acceptCard(const Card & card);
+    const std::optional<Card> topCard() const {return top_;}
+    std::optional<Card> getCard();
 
     friend std::ostream& operator<< (std::ostream& os, const HomeDestination & hd) ;
 
 private:
-    std::vector<Card> storage_;
+    std::optional<Card> top_;
 };
 
 bool operator< (const HomeDestination &lhs, const HomeDestination &rhs) ;
 bool operator== (const HomeDestination &lhs, const HomeDestination &rhs) ;
 
 
-class WorkStack : public CardStorage {
+class WorkStack final : public CardStorage {
 public:
-	static bool canSitOn(const Card &base, const Card &candidate);
-	bool canAccept(const Card & card) const override;
-    bool acceptCard(const Card & card) override;
-    const std::optional<Card> topCard() const override;
-    std::optional<Card> getCard() override;
-
-	size_t nbCards() const;
+	WorkStack() : CardStorage(Kind::Stack) {}
+
+	static bool canSitOn(const Card &base, const Card &candidate) {
+		return candidate.renderColor() != base.renderColor() && candidate.value() == base.value() - 1;
+	}
+	bool canAccept(const Card & card) const {
+		if (size_ == 0)
+			return true;
+		else
+			return canSitOn(cards_[size_ - 1], card);
+	}
+    bool acceptCard(const Card & card);
+    const std::optional<Card> topCard() const {
+		if (size_ > 0)
+			return cards_[size_ - 1];
+		else
+			return std::nullopt;
+	}
+    std::optional<Card> getCard();
+
+	size_t nbCards() const {return size_;}
 
 	// avoid canAccept, simply places the card on top
 	// useful for game setup
@@ -54,25 +113,25 @@ public:
     friend bool operator< (const WorkStack &lhs, const WorkStack &rhs) ;
     friend bool operator== (const WorkStack &lhs, const WorkStack &rhs) ;
 
-private:
-    std::vector<Card> storage_;
+    CardRange storage() const {return {cards_.data(), cards_.data() + size_};}
 
-public:
-    const decltype(storage_) &storage() const {return storage_;}
+private:
+    std::array<Card, max_stack_size> cards_{};
+    std::uint8_t size_ = 0;
 };
 
 bool operator< (const WorkStack &lhs, const WorkStack &rhs) ;
 bool operator== (const WorkStack &lhs, const WorkStack &rhs) ;
 
 
-class FreeCell : public CardStorage {
+class FreeCell final : public CardStorage {
 public:
-	FreeCell & operator=(FreeCell &other) ;
+	FreeCell() : CardStorage(Kind::FreeCell) {}
 
-	bool canAccept(const Card & card) const override;
-    bool acceptCard(const Card & card) override;
-    const std::optional<Card> topCard() const override;
-    std::optional<Card> getCard() override;
+	bool canAccept([[maybe_unused]] const Card & card) const {return !cell_.has_value();}
+    bool acceptCard(const Card & card);
+    const std::optional<Card> topCard() const {return cell_;}
+    std::optional<Card> getCard();
 
 private:
     std::optional<Card> cell_;
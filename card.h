@@ -2,6 +2,9 @@
 #define CARD_H
 
 
+#include <array>
+#include <cassert>
+#include <cstdint>
 #include <string>
 #include <map>
 #include <vector>
@@ -17,17 +20,49 @@ extern const std::map<Color, std::string> color_map;
 extern const std::map<Color, RenderColor> render_color_map;
 
 inline constexpr int king_value = 13;
+inline constexpr int nb_colors = 4;
+inline constexpr int nb_cards = nb_colors * king_value;
 
-struct Card {
-	Card(Color col, int val);
+// indexed by the underlying value of Color
+inline constexpr std::array<RenderColor, nb_colors> render_color_table {
+	RenderColor::Red,
+	RenderColor::Red,
+	RenderColor::Black,
+	RenderColor::Black,
+};
+
+// A card packed into a single byte, color in the upper nibble, value in the lower one.
+// Thus comparing the raw bytes orders cards by color first and by value second.
+class Card {
+public:
+	// leaves the value unspecified, only meant for fixed-capacity containers of cards
+	Card() = default;
+	constexpr Card(Color col, int val) :
+		bits_(static_cast<std::uint8_t>(static_cast<int>(col) << 4 | val)) {
+		assert(val >= 1 && val <= king_value);
+	}
+
+	constexpr Color color() const { return static_cast<Color>(bits_ >> 4); }
+	constexpr int value() const { return bits_ & 0x0f; }
+	constexpr RenderColor renderColor() const { return render_color_table[bits_ >> 4]; }
 
-	const Color color;
-	const int value;
+	// dense numbering of all cards in [0, nb_cards), handy for lookup tables
+	constexpr int index() const { return (bits_ >> 4) * king_value + value() - 1; }
+	static constexpr Card fromIndex(int index) {
+		return Card(static_cast<Color>(index / king_value), index % king_value + 1);
+	}
+
+	constexpr std::uint8_t bits() const { return bits_; }
+
+private:
+	std::uint8_t bits_;
 };
 
-bool operator==(const Card &a, const Card &b) ;
-bool operator!=(const Card &a, const Card &b) ;
-bool operator<(const Card &a, const Card &b) ;
+static_assert(sizeof(Card) == 1);
+
+constexpr bool operator==(const Card &a, const Card &b) { return a.bits() == b.bits(); }
+constexpr bool operator!=(const Card &a, const Card &b) { return a.bits() != b.bits(); }
+constexpr bool operator<(const Card &a, const Card &b) { return a.bits() < b.bits(); }
 
 std::ostream& operator<< (std::ostream& os, const Card & card) ;
 
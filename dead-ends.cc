@@ -0,0 +1,86 @@
+#include "dead-ends.h"
+#include "move-engine.h"
+
+namespace {
+
+bool isBlocked(const GameState &gs) {
+    for (const auto &fc : gs.free_cells) {
+        if (!fc.topCard().has_value())
+            return false;
+    }
+    for (const auto &stack : gs.stacks) {
+        if (stack.nbCards() == 0)
+            return false;
+    }
+
+    return true;
+}
+
+// a card which can go home right now lies uncovered
+bool canMoveHome(const GameState &gs) {
+    for (auto color : colors_list) {
+        int value = 1;
+        while (value <= king_value && cardIsHome(gs, {color, value}))
+            ++value;
+        if (value > king_value)
+            continue;
+
+        Card needed{color, value};
+        for (const auto &fc : gs.free_cells) {
+            auto opt_card = fc.topCard();
+            if (opt_card.has_value() && *opt_card == needed)
+                return true;
+        }
+        for (const auto &stack : gs.stacks) {
+            auto cards = stack.storage();
+            if (!cards.empty() && cards[cards.size() - 1] == needed)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+bool isFinal(const GameState &gs) {
+    for (auto color : colors_list) {
+        if (!cardIsHome(gs, {color, king_value}))
+            return false;
+    }
+
+    return true;
+}
+
+// the position is blocked and has no way to home
+bool stuckWithin(GameState &gs, int depth) {
+    if (!isBlocked(gs) || canMoveHome(gs))
+        return false;
+
+    MoveBuffer moves;
+    collectLegalMoves(gs, moves);
+    if (moves.empty())
+        return true;
+    if (depth == 0)
+        return false;
+
+    for (auto move : moves) {
+        slotMove(gs, move.from(), move.to());
+        bool stuck = stuckWithin(gs, depth - 1);
+        slotMove(gs, move.to(), move.from());
+
+        if (!stuck)
+            return false;
+    }
+
+    return true;
+}
+
+}
+
+bool isDeadEnd(const GameState &gs, int lookahead_depth) {
+    // any card can go to an empty free cell or stack, so only blocked positions run out of moves
+    if (isFinal(gs) || !isBlocked(gs))
+        return false;
+
+    GameState scratch = gs;
+    return stuckWithin(scratch, lookahead_depth);
+}
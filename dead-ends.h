@@ -0,0 +1,16 @@
+#ifndef DEAD_ENDS_H
+#define DEAD_ENDS_H
+
+#include "game.h"
+
+// The position provably can not be solved: it is not final and no sequence of moves
+// leads out of it within lookahead_depth moves.
+//
+// Only blocked positions, with no empty free cell and no empty stack, are searched.
+// Such a position lives on only if a card needed at home (the lowest of its suit not
+// home yet) can be uncovered, or a free cell or a stack emptied. As long as neither
+// happens, the only moves are single cards onto other stacks and from free cells,
+// which the lookahead tries out in place.
+bool isDeadEnd(const GameState &gs, int lookahead_depth) ;
+
+#endif
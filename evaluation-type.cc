@@ -6,16 +6,29 @@ std::ostream& operator<< (std::ostream& os, const StrategyEvaluation &report) {
             " [ " << 100.0*report.nb_solved / (report.nb_solved + report.nb_failed) << " % ]. " <<
             "Avg solution length " << 1.0 * report.total_solution_length / report.nb_solved << " steps, "
             "Avg time taken: " << (report.time_taken / report.nb_solved).count() << " us " <<
-            "Total #states expaned: " << report.nb_states_expanded << 
-            "\n";
+            "Total #states expaned: " << report.nb_states_expanded;
     } else {
         os << "Solved " << report.nb_solved << " / " << report.nb_solved + report.nb_failed <<
             " [ 0 % ]. " <<
             "Avg solution length NA steps, " <<
             "Avg time taken: NA us " <<
-            "Total #states expaned: " << report.nb_states_expanded << 
-            "\n";
+            "Total #states expaned: " << report.nb_states_expanded;
     }
 
+    if (report.nb_moves_pruned > 0)
+        os << " Total #moves pruned: " << report.nb_moves_pruned;
+    if (report.nb_dead_ends > 0)
+        os << " Total #dead ends: " << report.nb_dead_ends;
+    if (report.nb_heuristic_evaluations > 0) {
+        os << " Total #heuristic evaluations: " << report.nb_heuristic_evaluations;
+        if (report.nb_states_expanded > 0)
+            os << " [ " << 100.0 * report.nb_heuristic_evaluations / report.nb_states_expanded << " % of generated ]";
+    }
+    if (report.closed_lists.nb_slots > 0) {
+        os << " Closed list load: " << report.closed_lists.loadFactor() <<
+            ", probe length avg " << report.closed_lists.averageProbeLength() << " max " << report.closed_lists.max_probe;
+    }
+    os << "\n";
+
     return os;
 } 
@@ -1,15 +1,21 @@
 #ifndef EVALUATION_TYPE_H
 #define EVALUATION_TYPE_H
 
+#include "flat-state-set.h"
+
 #include <chrono>
 #include <iostream>
 
 struct StrategyEvaluation {
-	StrategyEvaluation() : nb_solved(0), nb_failed(0), total_solution_length(0), nb_states_expanded(0), time_taken(0) {}
+	StrategyEvaluation() : nb_solved(0), nb_failed(0), total_solution_length(0), nb_states_expanded(0), nb_moves_pruned(0), nb_dead_ends(0), nb_heuristic_evaluations(0), time_taken(0) {}
     unsigned long nb_solved;
     unsigned long nb_failed;
     unsigned long total_solution_length;
     unsigned long long nb_states_expanded;
+    unsigned long long nb_moves_pruned; // only reported when pruning is on
+    unsigned long long nb_dead_ends; // only reported when detecting dead ends
+    unsigned long long nb_heuristic_evaluations; // only reported for informed searches
+    ClosedListStats closed_lists; // only reported for searches with a closed list
     std::chrono::microseconds time_taken;
 };
 
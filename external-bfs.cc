@@ -0,0 +1,306 @@
+#include "search-strategies.h"
+#include "packed-state.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+class KeyWriter {
+public:
+	explicit KeyWriter(const fs::path &path) : out_(path, std::ios::binary | std::ios::trunc) {}
+
+	void write(const PackedState &key) {
+		out_.write(reinterpret_cast<const char *>(&key), sizeof(key));
+		++nb_written_;
+	}
+
+	size_t nbWritten() const {return nb_written_;}
+	bool good() const {return out_.good();}
+
+	// flushes and closes the file, false if any write failed (e.g. a full disk)
+	bool finish() {
+		out_.close();
+		return !out_.fail();
+	}
+
+private:
+	std::ofstream out_;
+	size_t nb_written_ = 0;
+};
+
+// Sequential reader with a lookahead of one key
+class KeyReader {
+public:
+	explicit KeyReader(const fs::path &path) : in_(path, std::ios::binary) {advance();}
+
+	bool done() const {return !current_.has_value();}
+	// the file could be opened and has been read without errors so far
+	bool good() const {return in_.is_open() && !in_.bad();}
+	const PackedState &current() const {return *current_;}
+
+	void advance() {
+		PackedState key;
+		if (in_.read(reinterpret_cast<char *>(&key), sizeof(key)))
+			current_ = key;
+		else
+			current_ = std::nullopt;
+	}
+
+	// skips the keys smaller than key, tells whether key itself is there
+	bool skipTo(const PackedState &key) {
+		while (!done() && current() < key)
+			advance();
+		return !done() && current() == key;
+	}
+
+private:
+	std::ifstream in_;
+	std::optional<PackedState> current_;
+};
+
+// Directory with the files of one search, removed with all its content at the end
+class WorkDirectory {
+public:
+	explicit WorkDirectory(const fs::path &parent) {
+		static std::atomic<int> counter{0};
+		auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+		path_ = parent / ("fc-sui-ebfs-" + std::to_string(stamp) + "-" + std::to_string(counter++));
+		fs::create_directories(path_, error_);
+	}
+	~WorkDirectory() {
+		std::error_code ignored;
+		if (!error_)
+			fs::remove_all(path_, ignored);
+	}
+
+	// why the directory could not be created, if it could not
+	const std::error_code &error() const {return error_;}
+	const fs::path &path() const {return path_;}
+
+	fs::path layer(size_t depth) const {return path_ / ("layer-" + std::to_string(depth));}
+	fs::path run(size_t index) const {return path_ / ("run-" + std::to_string(index));}
+
+private:
+	fs::path path_;
+	std::error_code error_;
+};
+
+SearchState stateFromKey(const PackedState &key, const MoveOptions &options) {
+	return SearchState(unpackState(key), options);
+}
+
+// false if the run could not be written completely
+bool writeRun(std::vector<PackedState> &buffer, const fs::path &path) {
+	std::sort(buffer.begin(), buffer.end());
+	buffer.erase(std::unique(buffer.begin(), buffer.end()), buffer.end());
+
+	KeyWriter writer(path);
+	for (const auto &key : buffer)
+		writer.write(key);
+	buffer.clear();
+
+	return writer.finish();
+}
+
+// Merges the sorted runs into the next layer, leaving out the keys of the two previous
+// layers (a move can not lead further back in a BFS, save for irreversible moves to home,
+// whose duplicates are merely expanded again). Returns the size of the new layer,
+// nothing if some file could not be read or written completely.
+std::optional<size_t> mergeRuns(const WorkDirectory &dir, size_t nb_runs, size_t depth) {
+	std::vector<std::unique_ptr<KeyReader>> runs;
+	for (size_t i = 0; i < nb_runs; ++i)
+		runs.push_back(std::make_unique<KeyReader>(dir.run(i)));
+
+	KeyReader current_layer(dir.layer(depth));
+	std::optional<KeyReader> previous_layer;
+	if (depth > 0)
+		previous_layer.emplace(dir.layer(depth - 1));
+
+	auto later = [&runs](size_t a, size_t b) {return runs[b]->current() < runs[a]->current();};
+	std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heads(later);
+	for (size_t i = 0; i < runs.size(); ++i) {
+		if (!runs[i]->done())
+			heads.push(i);
+	}
+
+	KeyWriter next_layer(dir.layer(depth + 1));
+	std::optional<PackedState> last;
+	while (!heads.empty()) {
+		size_t i = heads.top();
+		heads.pop();
+		PackedState key = runs[i]->current();
+		runs[i]->advance();
+		if (!runs[i]->done())
+			heads.push(i);
+
+		if (last.has_value() && *last == key)
+			continue;
+		last = key;
+
+		if (current_layer.skipTo(key) || (previous_layer.has_value() && previous_layer->skipTo(key)))
+			continue;
+		next_layer.write(key);
+	}
+
+	bool all_read = current_layer.good() && (!previous_layer.has_value() || previous_layer->good());
+	for (const auto &run : runs)
+		all_read = all_read && run->good();
+
+	std::error_code ignored;
+	for (size_t i = 0; i < nb_runs; ++i)
+		fs::remove(dir.run(i), ignored);
+
+	if (!next_layer.finish() || !all_read)
+		return std::nullopt;
+	return next_layer.nbWritten();
+}
+
+// The state of the layer at depth with a child of the given key, nothing if there is none
+std::optional<PackedState> findParent(const WorkDirectory &dir, size_t depth, const PackedState &child, const MoveOptions &options) {
+	MoveBuffer actions;
+	for (KeyReader layer(dir.layer(depth)); !layer.done(); layer.advance()) {
+		SearchState state = stateFromKey(layer.current(), options);
+		state.actions(actions);
+		for (auto move : actions) {
+			if (SearchAction(move).execute(state).packed() == child)
+				return layer.current();
+		}
+	}
+
+	return std::nullopt;
+}
+
+}
+
+std::vector<SearchAction> ExternalBreadthFirstSearch::solve(const SearchState &init_state) {
+	if (init_state.isFinal())
+		return {};
+
+	std::error_code error;
+	fs::path parent = work_dir_.empty() ? fs::temp_directory_path(error) : fs::path(work_dir_);
+	if (error) {
+		std::cerr << "External BFS: no temporary directory: " << error.message() << "\n";
+		return {};
+	}
+
+	WorkDirectory dir(parent);
+	if (dir.error()) {
+		std::cerr << "External BFS: can not create " << dir.path() << ": " << dir.error().message() << "\n";
+		return {};
+	}
+
+	// the search can not go on with layers cut short, it would miss states
+	auto ioFailure = [&dir]() {
+		std::cerr << "External BFS: reading or writing the files in " << dir.path() << " failed\n";
+		return std::vector<SearchAction>{};
+	};
+
+	KeyWriter first_layer(dir.layer(0));
+	first_layer.write(init_state.packed());
+	if (!first_layer.finish())
+		return ioFailure();
+
+	// a quarter of the memory for the buffer of children, the rest are small stream buffers
+	const size_t buffer_capacity = std::max<size_t>(mem_limit_ / 4 / sizeof(PackedState), 1024);
+	std::vector<PackedState> buffer;
+
+	std::optional<PackedState> final_parent;
+	size_t depth = 0;
+	MoveBuffer actions;
+
+	while (!final_parent.has_value()) {
+		size_t nb_runs = 0;
+		KeyReader layer(dir.layer(depth));
+		for (; !layer.done() && !final_parent.has_value(); layer.advance()) {
+			SearchState state = stateFromKey(layer.current(), init_state.options());
+			state.actions(actions);
+			for (auto move : actions) {
+				SearchState new_state = SearchAction(move).execute(state);
+				if (new_state.isFinal()) {
+					final_parent = layer.current();
+					break;
+				}
+				if (new_state.isDeadEnd())
+					continue;
+
+				buffer.push_back(new_state.packed());
+				if (buffer.size() >= buffer_capacity && !writeRun(buffer, dir.run(nb_runs++)))
+					return ioFailure();
+			}
+		}
+		if (!layer.good())
+			return ioFailure();
+
+		if (final_parent.has_value())
+			break;
+
+		if (!buffer.empty() && !writeRun(buffer, dir.run(nb_runs++)))
+			return ioFailure();
+
+		auto layer_size = mergeRuns(dir, nb_runs, depth);
+		if (!layer_size.has_value())
+			return ioFailure();
+		if (*layer_size == 0)
+			return {}; // the whole reachable space has been searched
+		++depth;
+	}
+
+	// the layers are complete, so a missing link means a file has changed under us
+	auto lostPath = [&dir]() {
+		std::cerr << "External BFS: the path to the solution could not be traced back through " << dir.path() << "\n";
+		return std::vector<SearchAction>{};
+	};
+
+	/* Backtracking the chain of states through the layers */
+	std::vector<PackedState> chain{*final_parent};
+	for (size_t d = depth; d > 0; --d) {
+		auto parent_key = findParent(dir, d - 1, chain.back(), init_state.options());
+		if (!parent_key.has_value())
+			return lostPath();
+		chain.push_back(*parent_key);
+	}
+	std::reverse(chain.begin(), chain.end());
+
+	// the layers hold canonical forms, so replay from the real initial state
+	// picking the moves which lead to the recorded states. The pruning depends on the
+	// move which led to a state, which the layers do not keep, so it is left out here.
+	MoveOptions replay_options = init_state.options();
+	replay_options.prune = false;
+	replay_options.por = false;
+
+	std::vector<SearchAction> solution;
+	SearchState state = init_state.withOptions(replay_options);
+	for (size_t i = 1; i < chain.size(); ++i) {
+		state.actions(actions);
+		auto found = std::find_if(actions.begin(), actions.end(), [&](PackedMove move) {
+			return SearchAction(move).execute(state).packed() == chain[i];
+		});
+		if (found == actions.end())
+			return lostPath();
+
+		solution.push_back(SearchAction(*found));
+		state = solution.back().execute(state);
+	}
+
+	// the final move is recorded on the canonical parent, find its counterpart
+	state.actions(actions);
+	auto final_move = std::find_if(actions.begin(), actions.end(), [&](PackedMove move) {
+		return SearchAction(move).execute(state).isFinal();
+	});
+	if (final_move == actions.end())
+		return lostPath();
+	solution.push_back(SearchAction(*final_move));
+
+	return solution;
+}
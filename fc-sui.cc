@@ -2,6 +2,7 @@
 #include "game.h"
 #include "search-interface.h"
 #include "search-strategies.h"
+#include "pattern-database.h"
 
 #include "evaluation-type.h"
 #include "argparse.h"
@@ -39,6 +40,10 @@ void eval_strategy(
         report->nb_failed++;
     }
     report->nb_states_expanded = SearchState::nbExpanded();
+    report->nb_moves_pruned = SearchState::nbPruned();
+    report->nb_dead_ends = SearchState::nbDeadEnds();
+    report->nb_heuristic_evaluations = SearchState::nbEvaluated();
+    report->closed_lists += search_strategy->closedListStats();
 }
 
 std::unique_ptr<InitialStateProducerItf> getProducer(const argparse::ArgumentParser &parser) {
@@ -59,13 +64,38 @@ std::unique_ptr<AStarHeuristicItf> getHeuristic(const argparse::ArgumentParser &
         return std::make_unique<OufOfHome_Pseudo>();
     } else if (heuristic_name == "student") {
 	    return std::make_unique<StudentHeuristic>();
+    } else if (heuristic_name == "pdb") {
+        return std::make_unique<PatternDatabaseHeuristic>(parser.get<std::string>("--pdb-file"));
     } else {
         std::cerr << "Unknown heuristic name '" << heuristic_name << "'\n";
-        std::cerr << "Supported are: nb_not_home, student\n";
+        std::cerr << "Supported are: nb_not_home, student, pdb\n";
         std::exit(2);
     }
 }
 
+TieBreak getTieBreak(const argparse::ArgumentParser &parser) {
+    auto tie_break_name = parser.get<std::string>("--tie-break");
+
+    if (tie_break_name == "h") {
+        return TieBreak::LowH;
+    } else if (tie_break_name == "g") {
+        return TieBreak::LowG;
+    } else {
+        std::cerr << "Unknown tie-break '" << tie_break_name << "'\n";
+        std::cerr << "Supported are: h, g\n";
+        std::exit(2);
+    }
+}
+
+MoveOptions getMoveOptions(const argparse::ArgumentParser &parser) {
+    MoveOptions options;
+    options.supermoves = parser.get<bool>("--supermoves");
+    options.prune = parser.get<bool>("--prune");
+    options.por = parser.get<bool>("--por");
+    options.dead_end_depth = parser.get<int>("--dead-ends");
+    return options;
+}
+
 std::unique_ptr<SearchStrategyItf> getSolver(const argparse::ArgumentParser &parser) {
     auto solver_name = parser.get<std::string>("--solver");
 
@@ -73,13 +103,59 @@ std::unique_ptr<SearchStrategyItf> getSolver(const argparse::ArgumentParser &par
         return std::make_unique<DummySearch>(500, 5);
     } else if (solver_name == "bfs") {
 	    return std::make_unique<BreadthFirstSearch>(parser.get<size_t>("--mem-limit"));
+    } else if (solver_name == "external_bfs") {
+	    return std::make_unique<ExternalBreadthFirstSearch>(parser.get<size_t>("--mem-limit"), parser.get<std::string>("--work-dir"));
     } else if (solver_name == "dfs") {
         return std::make_unique<DepthFirstSearch>(parser.get<int>("--dls-limit"), parser.get<size_t>("--mem-limit"));
+    } else if (solver_name == "parallel_dfs") {
+        return std::make_unique<ParallelDepthFirstSearch>(
+            parser.get<int>("--dls-limit"),
+            parser.get<size_t>("--mem-limit"),
+            parser.get<size_t>("--threads")
+        );
     } else if (solver_name == "a_star") {
-        return std::make_unique<AStarSearch>(getHeuristic(parser), parser.get<size_t>("--mem-limit"));
+        return std::make_unique<AStarSearch>(
+            getHeuristic(parser),
+            parser.get<size_t>("--mem-limit"),
+            getTieBreak(parser),
+            parser.get<bool>("--lazy-heuristic")
+        );
+    } else if (solver_name == "beam") {
+        return std::make_unique<BeamSearch>(getHeuristic(parser), parser.get<size_t>("--beam-width"));
+    } else if (solver_name == "anytime_a_star") {
+        return std::make_unique<AnytimeAStarSearch>(
+            getHeuristic(parser),
+            parser.get<size_t>("--mem-limit"),
+            std::chrono::milliseconds(parser.get<int>("--time-limit")),
+            parser.get<double>("--weight")
+        );
+    } else if (solver_name == "rollout") {
+        // a negative bias would prefer the worst children with weights beyond any bound
+        if (parser.get<double>("--rollout-bias") < 0) {
+            std::cerr << "The rollout bias must not be negative\n";
+            std::exit(2);
+        }
+        return std::make_unique<RolloutSearch>(
+            getHeuristic(parser),
+            parser.get<size_t>("--rollouts"),
+            parser.get<size_t>("--rollout-depth"),
+            parser.get<std::uint64_t>("--rollout-seed"),
+            parser.get<double>("--rollout-bias"),
+            parser.get<size_t>("--threads")
+        );
+    } else if (solver_name == "ida_star") {
+        return std::make_unique<IDAStarSearch>(getHeuristic(parser), parser.get<size_t>("--tt-size"));
+    } else if (solver_name == "hda_star") {
+        return std::make_unique<HDAStarSearch>(
+            getHeuristic(parser),
+            parser.get<size_t>("--mem-limit"),
+            parser.get<size_t>("--threads"),
+            getTieBreak(parser),
+            parser.get<bool>("--hda-first-solution")
+        );
     } else {
         std::cerr << "Unknown solver name '" << solver_name << "'\n";
-        std::cerr << "Supported are: dummy, bfs, a_star, dfs\n";
+        std::cerr << "Supported are: dummy, bfs, external_bfs, a_star, dfs, parallel_dfs, anytime_a_star, ida_star, hda_star, beam, rollout\n";
         std::exit(2);
     }
 }
@@ -93,8 +169,26 @@ int main(int argc, const char *argv[]) {
     parser.add_argument("--easy-mode").default_value(-1).scan<'d', int>();
     parser.add_argument("--solver").default_value(std::string("dummy"));
     parser.add_argument("--heuristic").default_value(std::string("nb_not_home"));
+    parser.add_argument("--tie-break").default_value(std::string("h"));
     parser.add_argument("--dls-limit").default_value(1'000'000).scan<'d', int>();
+    parser.add_argument("--threads").default_value(std::size_t{0}).scan<'u', size_t>();
+    parser.add_argument("--supermoves").default_value(false).implicit_value(true);
+    parser.add_argument("--prune").default_value(false).implicit_value(true);
+    parser.add_argument("--por").default_value(false).implicit_value(true);
+    parser.add_argument("--dead-ends").default_value(-1).scan<'d', int>();
+    parser.add_argument("--weight").default_value(5.0).scan<'g', double>();
+    parser.add_argument("--time-limit").default_value(0).scan<'d', int>();
+    parser.add_argument("--beam-width").default_value(std::size_t{100}).scan<'u', size_t>();
+    parser.add_argument("--tt-size").default_value(std::size_t{1} << 20).scan<'u', size_t>();
+    parser.add_argument("--work-dir").default_value(std::string(""));
+    parser.add_argument("--pdb-file").default_value(std::string(""));
+    parser.add_argument("--lazy-heuristic").default_value(false).implicit_value(true);
+    parser.add_argument("--rollouts").default_value(std::size_t{10'000}).scan<'u', size_t>();
+    parser.add_argument("--rollout-depth").default_value(std::size_t{500}).scan<'u', size_t>();
+    parser.add_argument("--rollout-seed").default_value(std::uint64_t{1337}).scan<'u', std::uint64_t>();
+    parser.add_argument("--rollout-bias").default_value(1.0).scan<'g', double>();
     parser.add_argument("--mem-limit").default_value(std::size_t{2'147'483'648}).scan<'u', size_t>();
+    parser.add_argument("--hda-first-solution").default_value(false).implicit_value(true);
 
     try {
         parser.parse_args(argc, argv);
@@ -119,7 +213,7 @@ int main(int argc, const char *argv[]) {
     auto nb_games = parser.get<int>("nb_games");
     for (int i = 0; i < nb_games; ++i) {
         GameState gs = producer->produce();
-        SearchState init_state(gs);
+        SearchState init_state(gs, getMoveOptions(parser));
         eval_strategy(search_strategy, init_state, &evaluation_record);
     }
 
@@ -0,0 +1,297 @@
+#include "flat-state-set.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+constexpr PackedState empty_key{};
+
+bool isEmpty(const PackedState &key) {
+    return key == empty_key;
+}
+
+size_t roundUpToPowerOfTwo(size_t n) {
+    size_t result = 1;
+    while (result < n)
+        result *= 2;
+    return result;
+}
+
+}
+
+ClosedListStats &ClosedListStats::operator+=(const ClosedListStats &other) {
+    nb_keys += other.nb_keys;
+    nb_slots += other.nb_slots;
+    total_probe += other.total_probe;
+    max_probe = std::max(max_probe, other.max_probe);
+    return *this;
+}
+
+double ClosedListStats::loadFactor() const {
+    if (nb_slots == 0)
+        return 0.0;
+    return static_cast<double>(nb_keys) / nb_slots;
+}
+
+double ClosedListStats::averageProbeLength() const {
+    if (nb_keys == 0)
+        return 0.0;
+    return static_cast<double>(total_probe) / nb_keys;
+}
+
+FlatStateSet::FlatStateSet(size_t max_bytes, size_t initial_capacity) :
+        max_bytes_(max_bytes) {
+    size_t capacity = roundUpToPowerOfTwo(std::max<size_t>(initial_capacity, 16));
+    while (capacity > 16 && capacity * sizeof(PackedState) > max_bytes_)
+        capacity /= 2;
+
+    keys_.resize(capacity);
+    mask_ = capacity - 1;
+}
+
+size_t FlatStateSet::homeSlot_(const PackedState &key) const {
+    return packedStateHash(key) & mask_;
+}
+
+bool FlatStateSet::canGrow_() const {
+    return keys_.size() * 2 * sizeof(PackedState) <= max_bytes_;
+}
+
+bool FlatStateSet::insert(const PackedState &key) {
+    assert(!isEmpty(key));
+
+    size_t slot = homeSlot_(key);
+    size_t probe = 0;
+    for (; !isEmpty(keys_[slot]); slot = (slot + 1) & mask_, ++probe) {
+        if (keys_[slot] == key)
+            return false;
+    }
+
+    // the key is new, make sure there is room for it first
+    size_t capacity = keys_.size();
+    if ((size_ + 1) * 4 > capacity * 3) {
+        if (canGrow_()) {
+            rehash_(capacity * 2);
+            place_(key);
+            return true;
+        } else if ((size_ + 1) * 16 > capacity * 15) {
+            full_ = true;
+            return false;
+        }
+    }
+
+    keys_[slot] = key;
+    ++size_;
+    total_probe_ += probe;
+    max_probe_ = std::max(max_probe_, probe);
+    return true;
+}
+
+bool FlatStateSet::contains(const PackedState &key) const {
+    for (size_t slot = homeSlot_(key); !isEmpty(keys_[slot]); slot = (slot + 1) & mask_) {
+        if (keys_[slot] == key)
+            return true;
+    }
+
+    return false;
+}
+
+void FlatStateSet::clear() {
+    std::fill(keys_.begin(), keys_.end(), empty_key);
+    size_ = 0;
+    total_probe_ = 0;
+    max_probe_ = 0;
+    full_ = false;
+}
+
+void FlatStateSet::reserve(size_t nb_keys) {
+    size_t wanted = roundUpToPowerOfTwo(nb_keys + nb_keys / 3 + 1);
+    while (wanted > keys_.size() && wanted * sizeof(PackedState) > max_bytes_)
+        wanted /= 2;
+
+    if (wanted > keys_.size())
+        rehash_(wanted);
+}
+
+// expects a key that is not present yet and a free slot for it
+void FlatStateSet::place_(const PackedState &key) {
+    size_t slot = homeSlot_(key);
+    size_t probe = 0;
+    for (; !isEmpty(keys_[slot]); slot = (slot + 1) & mask_)
+        ++probe;
+
+    keys_[slot] = key;
+    ++size_;
+    total_probe_ += probe;
+    max_probe_ = std::max(max_probe_, probe);
+}
+
+void FlatStateSet::rehash_(size_t new_capacity) {
+    std::vector<PackedState> old_keys(new_capacity);
+    old_keys.swap(keys_);
+    mask_ = new_capacity - 1;
+    size_ = 0;
+    total_probe_ = 0;
+    max_probe_ = 0;
+
+    for (const auto &key : old_keys) {
+        if (!isEmpty(key))
+            place_(key);
+    }
+}
+
+double FlatStateSet::loadFactor() const {
+    return static_cast<double>(size_) / keys_.size();
+}
+
+double FlatStateSet::averageProbeLength() const {
+    if (size_ == 0)
+        return 0.0;
+    return static_cast<double>(total_probe_) / size_;
+}
+
+ClosedListStats FlatStateSet::stats() const {
+    return {size_, keys_.size(), total_probe_, max_probe_};
+}
+
+std::ostream& operator<< (std::ostream& os, const FlatStateSet & set) {
+    os << set.size() << " states in " << set.capacity() << " slots, "
+        << "load " << set.loadFactor() << ", "
+        << "probe length avg " << set.averageProbeLength() << " max " << set.maxProbeLength();
+    return os;
+}
+
+FlatStateCosts::FlatStateCosts(size_t max_bytes, size_t initial_capacity) :
+        max_bytes_(max_bytes) {
+    size_t capacity = roundUpToPowerOfTwo(std::max<size_t>(initial_capacity, 16));
+    while (capacity > 16 && capacity * entry_bytes > max_bytes_)
+        capacity /= 2;
+
+    keys_.resize(capacity);
+    costs_.resize(capacity);
+    mask_ = capacity - 1;
+}
+
+size_t FlatStateCosts::homeSlot_(const PackedState &key) const {
+    return packedStateHash(key) & mask_;
+}
+
+bool FlatStateCosts::canGrow_() const {
+    return keys_.size() * 2 * entry_bytes <= max_bytes_;
+}
+
+bool FlatStateCosts::lower(const PackedState &key, int cost) {
+    assert(!isEmpty(key));
+
+    size_t slot = homeSlot_(key);
+    size_t probe = 0;
+    for (; !isEmpty(keys_[slot]); slot = (slot + 1) & mask_, ++probe) {
+        if (keys_[slot] != key)
+            continue;
+
+        if (costs_[slot] <= cost)
+            return false;
+        costs_[slot] = cost;
+        return true;
+    }
+
+    // the key is new, make sure there is room for it first
+    size_t capacity = keys_.size();
+    if ((size_ + 1) * 4 > capacity * 3) {
+        if (canGrow_()) {
+            rehash_(capacity * 2);
+            place_(key, cost);
+            return true;
+        } else if ((size_ + 1) * 16 > capacity * 15) {
+            full_ = true;
+            return false;
+        }
+    }
+
+    keys_[slot] = key;
+    costs_[slot] = cost;
+    ++size_;
+    total_probe_ += probe;
+    max_probe_ = std::max(max_probe_, probe);
+    return true;
+}
+
+int FlatStateCosts::cost(const PackedState &key) const {
+    for (size_t slot = homeSlot_(key); !isEmpty(keys_[slot]); slot = (slot + 1) & mask_) {
+        if (keys_[slot] == key)
+            return costs_[slot];
+    }
+
+    return std::numeric_limits<int>::max();
+}
+
+// expects a key that is not present yet and a free slot for it
+void FlatStateCosts::place_(const PackedState &key, int cost) {
+    size_t slot = homeSlot_(key);
+    size_t probe = 0;
+    for (; !isEmpty(keys_[slot]); slot = (slot + 1) & mask_)
+        ++probe;
+
+    keys_[slot] = key;
+    costs_[slot] = cost;
+    ++size_;
+    total_probe_ += probe;
+    max_probe_ = std::max(max_probe_, probe);
+}
+
+void FlatStateCosts::rehash_(size_t new_capacity) {
+    std::vector<PackedState> old_keys(new_capacity);
+    std::vector<int> old_costs(new_capacity);
+    old_keys.swap(keys_);
+    old_costs.swap(costs_);
+    mask_ = new_capacity - 1;
+    size_ = 0;
+    total_probe_ = 0;
+    max_probe_ = 0;
+
+    for (size_t i = 0; i < old_keys.size(); ++i) {
+        if (!isEmpty(old_keys[i]))
+            place_(old_keys[i], old_costs[i]);
+    }
+}
+
+ClosedListStats FlatStateCosts::stats() const {
+    return {size_, keys_.size(), total_probe_, max_probe_};
+}
+
+ShardedStateSet::ShardedStateSet(size_t max_bytes) {
+    for (int i = 0; i < (1 << shard_bits); ++i)
+        shards_.push_back(std::make_unique<Shard_>(max_bytes >> shard_bits));
+}
+
+bool ShardedStateSet::insert(const PackedState &key) {
+    Shard_ &shard = *shards_[packedStateHash(key) >> (64 - shard_bits)];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (shard.set.insert(key))
+        return true;
+
+    if (shard.set.full())
+        full_ = true;
+    return false;
+}
+
+size_t ShardedStateSet::size() const {
+    size_t total = 0;
+    for (const auto &shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->set.size();
+    }
+
+    return total;
+}
+
+ClosedListStats ShardedStateSet::stats() const {
+    ClosedListStats total;
+    for (const auto &shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        total += shard->set.stats();
+    }
+
+    return total;
+}
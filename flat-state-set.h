@@ -0,0 +1,148 @@
+#ifndef FLAT_STATE_SET_H
+#define FLAT_STATE_SET_H
+
+#include "packed-state.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Occupancy of a closed list, or of several ones summed up
+struct ClosedListStats {
+    std::uint64_t nb_keys = 0;
+    std::uint64_t nb_slots = 0;
+    // slots between the keys and their home slots, summed up
+    std::uint64_t total_probe = 0;
+    size_t max_probe = 0;
+
+    ClosedListStats &operator+=(const ClosedListStats &other);
+    double loadFactor() const;
+    double averageProbeLength() const;
+};
+
+// Closed list of packed states. The keys are stored right in one flat array, with
+// open addressing and linear probing. The all-zero key cannot come from packState()
+// (no two cards can rest on the same card) and marks the empty slots.
+//
+// The table doubles once it is 3/4 full, as long as the doubled table fits into
+// max_bytes. Beyond that it fills up to 15/16 and then refuses new keys, see full().
+class FlatStateSet {
+public:
+    explicit FlatStateSet(
+        size_t max_bytes = std::numeric_limits<size_t>::max(),
+        size_t initial_capacity = 1 << 12
+    );
+
+    // true if the key was not present and got inserted
+    bool insert(const PackedState &key);
+    bool contains(const PackedState &key) const;
+    void clear();
+
+    // prepares the table for nb_keys keys, within the memory budget
+    void reserve(size_t nb_keys);
+
+    // the last insert() was refused for lack of memory
+    bool full() const {return full_;}
+
+    size_t size() const {return size_;}
+    size_t capacity() const {return keys_.size();}
+    size_t bytes() const {return keys_.size() * sizeof(PackedState);}
+
+    double loadFactor() const;
+    // how many slots past its home slot a key lies on average, 0 when it sits right there
+    double averageProbeLength() const;
+    size_t maxProbeLength() const {return max_probe_;}
+
+    ClosedListStats stats() const;
+
+private:
+    size_t homeSlot_(const PackedState &key) const;
+    bool canGrow_() const;
+    void rehash_(size_t new_capacity);
+    void place_(const PackedState &key);
+
+    std::vector<PackedState> keys_;
+    size_t mask_;
+    size_t size_ = 0;
+    size_t max_bytes_;
+    std::uint64_t total_probe_ = 0;
+    size_t max_probe_ = 0;
+    bool full_ = false;
+};
+
+std::ostream& operator<< (std::ostream& os, const FlatStateSet & set) ;
+
+// Lowest cost each packed state has been reached with. Laid out and grown like
+// FlatStateSet, with the costs in a second array alongside the keys.
+class FlatStateCosts {
+public:
+    explicit FlatStateCosts(
+        size_t max_bytes = std::numeric_limits<size_t>::max(),
+        size_t initial_capacity = 1 << 12
+    );
+
+    // true if the key was not present or had a higher cost, and cost got recorded
+    bool lower(const PackedState &key, int cost);
+    // the recorded cost, std::numeric_limits<int>::max() for an absent key
+    int cost(const PackedState &key) const;
+
+    // the last lower() was refused for lack of memory
+    bool full() const {return full_;}
+
+    size_t size() const {return size_;}
+    size_t bytes() const {return keys_.size() * entry_bytes;}
+
+    ClosedListStats stats() const;
+
+private:
+    static constexpr size_t entry_bytes = sizeof(PackedState) + sizeof(int);
+
+    size_t homeSlot_(const PackedState &key) const;
+    bool canGrow_() const;
+    void rehash_(size_t new_capacity);
+    void place_(const PackedState &key, int cost);
+
+    std::vector<PackedState> keys_;
+    std::vector<int> costs_;
+    size_t mask_;
+    size_t size_ = 0;
+    size_t max_bytes_;
+    std::uint64_t total_probe_ = 0;
+    size_t max_probe_ = 0;
+    bool full_ = false;
+};
+
+// Closed list shared by several threads, split into independently locked shards.
+// The shard is picked by the top bits of the hash, FlatStateSet uses the bottom ones.
+class ShardedStateSet {
+public:
+    explicit ShardedStateSet(size_t max_bytes = std::numeric_limits<size_t>::max());
+
+    // true if the key was not present and got inserted
+    bool insert(const PackedState &key);
+    // some shard has refused a key for lack of memory
+    bool full() const {return full_.load(std::memory_order_relaxed);}
+
+    size_t size() const;
+    // summed over the shards
+    ClosedListStats stats() const;
+
+private:
+    static constexpr int shard_bits = 6;
+
+    struct Shard_ {
+        explicit Shard_(size_t max_bytes) : set(max_bytes) {}
+        mutable std::mutex mutex;
+        FlatStateSet set;
+    };
+
+    std::vector<std::unique_ptr<Shard_>> shards_;
+    std::atomic<bool> full_{false};
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "game.h"
 #include "move.h"
+#include "move-engine.h"
 
 #include <algorithm>
 #include <cassert>
@@ -16,44 +17,47 @@ std::vector<CardStorage *> collect_location_pointers(In begin, In end) {
     return adresses;
 }
 
-GameState::GameState(void) {
-    recalculatePointerArrays_();
-}
+namespace {
 
-void GameState::recalculatePointerArrays_(void) {
-    assert(nb_freecells == nb_homes);
-    for (int i=0; i<nb_freecells; ++i) {
-        non_homes[i] = &free_cells[i];
-        all_storage[i] = &free_cells[i];
-    }
+template <typename Storage, typename GS>
+std::array<Storage *, nb_stacks+nb_freecells+nb_homes> collectAllStorage(GS &gs) {
+    std::array<Storage *, nb_stacks+nb_freecells+nb_homes> storages;
+    for (int i=0; i<nb_freecells; ++i)
+        storages[i] = &gs.free_cells[i];
 
-    for (int i=0; i<nb_stacks; ++i) {
-        non_homes[i + nb_freecells] = &stacks[i];
-        all_storage[i + nb_freecells] = &stacks[i];
-    }
+    for (int i=0; i<nb_stacks; ++i)
+        storages[first_stack_slot + i] = &gs.stacks[i];
 
     for (int i=0; i<nb_homes; ++i)
-        all_storage[i + nb_freecells + nb_stacks] = &homes[i];
+        storages[first_home_slot + i] = &gs.homes[i];
+
+    return storages;
+}
+
+template <typename Storage, typename GS>
+std::array<Storage *, nb_stacks+nb_freecells> collectNonHomes(GS &gs) {
+    auto all = collectAllStorage<Storage>(gs);
+    std::array<Storage *, nb_stacks+nb_freecells> storages;
+    std::copy(all.begin(), all.begin() + first_home_slot, storages.begin());
+    return storages;
+}
+
 }
 
-GameState::GameState(const GameState &other) :
-        homes(other.homes),
-        free_cells(other.free_cells),
-        stacks(other.stacks) 
-    {
-    recalculatePointerArrays_();
+std::array<CardStorage *, nb_stacks+nb_freecells> GameState::nonHomes() {
+    return collectNonHomes<CardStorage>(*this);
 }
 
-GameState& GameState::operator=(GameState &&other) {
-    std::swap(homes, other.homes);
-    std::swap(stacks, other.stacks);
+std::array<const CardStorage *, nb_stacks+nb_freecells> GameState::nonHomes() const {
+    return collectNonHomes<const CardStorage>(*this);
+}
 
-    for (size_t i = 0; i < nb_freecells; ++i)
-        free_cells[i] = other.free_cells[i];
+std::array<CardStorage *, nb_stacks+nb_freecells+nb_homes> GameState::allStorage() {
+    return collectAllStorage<CardStorage>(*this);
+}
 
-    recalculatePointerArrays_();
-    
-    return *this;
+std::array<const CardStorage *, nb_stacks+nb_freecells+nb_homes> GameState::allStorage() const {
+    return collectAllStorage<const CardStorage>(*this);
 }
 
 bool operator<(const GameState &lhs, const GameState &rhs) {
@@ -71,8 +75,8 @@ bool operator==(const GameState &lhs, const GameState &rhs) {
 std::vector<Card> topCards(const GameState &gs) {
     std::vector<Card> cards;
 
-    for (auto &cs : gs.non_homes) {
-        auto opt_card = cs->topCard();
+    for (int slot = 0; slot < first_home_slot; ++slot) {
+        auto opt_card = topCardAt(gs, slot);
         if (opt_card.has_value())
             cards.push_back(*opt_card);
     }
@@ -233,7 +237,7 @@ auto findHomeFor(const GameState &gs, Card card) -> decltype(gs.homes)::const_it
     return std::find_if(
         gs.homes.begin(),
         gs.homes.end(),
-        [&](const CardStorage &cs){return cs.canAccept(card);}
+        [&](const HomeDestination &home){return home.canAccept(card);}
     );
 }
 
@@ -243,7 +247,7 @@ bool cardIsHome(const GameState &gs, Card card) {
         if (!opt_top_card.has_value())
             continue;
 
-        if (opt_top_card->color == card.color && opt_top_card->value >= card.value)
+        if (opt_top_card->color() == card.color() && opt_top_card->value() >= card.value())
             return true;
     }
 
@@ -254,18 +258,18 @@ bool cardCouldGoHome(const GameState &gs, Card card) {
     // Aces can always go home
     // Thus, twos can go too, as an Ace will never need to rest
     // on a two
-    if (card.value == 1 or card.value == 2)
+    if (card.value() == 1 or card.value() == 2)
         return true;
 
-    auto render_color{render_color_map.at(card.color)}; 
+    auto render_color{card.renderColor()};
     std::vector<Color> opposite_rc_colors;
     bool safe = true;
 
     for (auto & color : colors_list) {
-        if (render_color_map.at(color) == render_color)
+        if (render_color_table[static_cast<int>(color)] == render_color)
             continue;
 
-        if (!cardIsHome(gs, {color, card.value-1}))
+        if (!cardIsHome(gs, {color, card.value()-1}))
             safe = false;
     }
 
@@ -275,20 +279,152 @@ bool cardCouldGoHome(const GameState &gs, Card card) {
 std::vector<RawMove> safeHomeMoves(const GameState &gs) {
     std::vector<RawMove> moves;
 
-    for (auto &cs : gs.non_homes) {
-        auto opt_card = cs->topCard();
-
+    for (int from = 0; from < first_home_slot; ++from) {
+        auto opt_card = topCardAt(gs, from);
         if (!opt_card.has_value())
             continue;
 
-        auto home_it = findHomeFor(gs, *opt_card);
-        if (home_it != gs.homes.end() && cardCouldGoHome(gs, *opt_card))
-            moves.push_back({cs, home_it});
+        int to = safeHomeSlotFor(gs, *opt_card);
+        if (to >= 0)
+            moves.push_back({ptrFromLoc(gs, locFromSlot(from)), ptrFromLoc(gs, locFromSlot(to))});
     }
 
     return moves;
 }
 
+GameState canonicalForm(const GameState &gs) {
+    GameState canonical;
+
+    for (const auto &home : gs.homes) {
+        auto opt_top = home.topCard();
+        if (opt_top.has_value())
+            canonical.homes[static_cast<int>(opt_top->color())] = home;
+    }
+
+    std::array<Card, nb_freecells> cell_cards;
+    size_t nb_cell_cards = 0;
+    for (const auto &fc : gs.free_cells) {
+        auto opt_card = fc.topCard();
+        if (!opt_card.has_value())
+            continue;
+
+        // insertion sort, there are just a few of them
+        size_t pos = nb_cell_cards++;
+        for (; pos > 0 && *opt_card < cell_cards[pos - 1]; --pos)
+            cell_cards[pos] = cell_cards[pos - 1];
+        cell_cards[pos] = *opt_card;
+    }
+    for (size_t i = 0; i < nb_cell_cards; ++i)
+        canonical.free_cells[i].acceptCard(cell_cards[i]);
+
+    std::array<size_t, nb_stacks> order;
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){return gs.stacks[a] < gs.stacks[b];});
+    for (size_t i = 0; i < order.size(); ++i)
+        canonical.stacks[i] = gs.stacks[order[i]];
+
+    return canonical;
+}
+
+constexpr std::uint64_t splitMix64(std::uint64_t &state) {
+    std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+constexpr auto makeZobristKeys() {
+    std::array<std::array<std::uint64_t, nb_zobrist_supports>, nb_cards> keys{};
+    std::uint64_t state = 0x5eed;
+    for (auto &card_keys : keys) {
+        for (auto &key : card_keys)
+            key = splitMix64(state);
+    }
+
+    return keys;
+}
+
+constexpr auto zobrist_keys = makeZobristKeys();
+
+// what the top card of the slot rests on when it leaves
+int supportOfTop(const GameState &gs, int slot) {
+    if (slot < first_stack_slot)
+        return zobrist_in_free_cell;
+    if (slot >= first_home_slot)
+        return zobrist_at_home;
+
+    auto cards = gs.stacks[slot - first_stack_slot].storage();
+    return cards.size() >= 2 ? cards[cards.size() - 2].index() : zobrist_on_stack_bottom;
+}
+
+// what a card placed into the slot rests on
+int supportOnTop(const GameState &gs, int slot) {
+    if (slot < first_stack_slot)
+        return zobrist_in_free_cell;
+    if (slot >= first_home_slot)
+        return zobrist_at_home;
+
+    auto cards = gs.stacks[slot - first_stack_slot].storage();
+    return cards.empty() ? zobrist_on_stack_bottom : cards[cards.size() - 1].index();
+}
+
+std::uint64_t zobristKey(Card card, int support) {
+    return zobrist_keys[card.index()][support];
+}
+
+std::uint64_t zobristHash(const GameState &gs) {
+    std::uint64_t hash = 0;
+
+    for (const auto &home : gs.homes) {
+        auto opt_top = home.topCard();
+        if (opt_top.has_value())
+            hash ^= zobristKey(*opt_top, zobrist_at_home);
+    }
+
+    for (const auto &fc : gs.free_cells) {
+        auto opt_card = fc.topCard();
+        if (opt_card.has_value())
+            hash ^= zobristKey(*opt_card, zobrist_in_free_cell);
+    }
+
+    for (const auto &stack : gs.stacks) {
+        int support = zobrist_on_stack_bottom;
+        for (const auto &card : stack.storage()) {
+            hash ^= zobristKey(card, support);
+            support = card.index();
+        }
+    }
+
+    return hash;
+}
+
+std::uint64_t zobristMoveDelta(const GameState &gs, int from_slot, int to_slot) {
+    auto card = *topCardAt(gs, from_slot);
+
+    std::uint64_t delta = zobristKey(card, supportOfTop(gs, from_slot)) ^ zobristKey(card, supportOnTop(gs, to_slot));
+
+    // homes only account for their top cards
+    if (from_slot >= first_home_slot && card.value() > 1)
+        delta ^= zobristKey(Card(card.color(), card.value() - 1), zobrist_at_home);
+    if (to_slot >= first_home_slot) {
+        auto opt_top = gs.homes[to_slot - first_home_slot].topCard();
+        if (opt_top.has_value())
+            delta ^= zobristKey(*opt_top, zobrist_at_home);
+    }
+
+    return delta;
+}
+
+std::uint64_t zobristRunDelta(const GameState &gs, int from_slot, int to_slot, int nb_cards) {
+    // all the cards but the bottom one of the run keep resting on the same cards
+    auto cards = gs.stacks[from_slot - first_stack_slot].storage();
+    size_t bottom = cards.size() - nb_cards;
+    int old_support = bottom > 0 ? cards[bottom - 1].index() : zobrist_on_stack_bottom;
+
+    return zobristKey(cards[bottom], old_support) ^ zobristKey(cards[bottom], supportOnTop(gs, to_slot));
+}
+
 std::ostream& operator<< (std::ostream& os, const GameState & state) {
     os << "Homes: " <<
         state.homes[0] << " " <<
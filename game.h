@@ -5,28 +5,34 @@
 #include "move.h"
 
 #include <array>
+#include <cstdint>
+#include <functional>
 #include <random>
+#include <type_traits>
 
 inline constexpr int nb_freecells = 4;
 inline constexpr int nb_homes = 4;
 inline constexpr int nb_stacks = 8;
 
 
+// Plain value type, copying a state is a single memcpy. Pointers to the individual
+// storages are only built on demand, they would have to be fixed up after every copy.
 struct GameState {
-    GameState(void);
-    GameState(const GameState &other);
-    GameState& operator=(GameState &&other);
-
     std::array<HomeDestination, nb_homes> homes; // Foundation
     std::array<FreeCell, nb_freecells> free_cells; // Na odklad
     std::array<WorkStack, nb_stacks> stacks; // Columns
 
-    std::array<CardStorage *, nb_stacks+nb_freecells> non_homes;
-    std::array<CardStorage *, nb_stacks+nb_freecells+nb_homes> all_storage;
+    // free cells and stacks, in the order of slots
+    std::array<CardStorage *, nb_stacks+nb_freecells> nonHomes();
+    std::array<const CardStorage *, nb_stacks+nb_freecells> nonHomes() const;
 
-    void recalculatePointerArrays_(void) ;
+    // every storage, in the order of slots
+    std::array<CardStorage *, nb_stacks+nb_freecells+nb_homes> allStorage();
+    std::array<const CardStorage *, nb_stacks+nb_freecells+nb_homes> allStorage() const;
 };
 
+static_assert(std::is_trivially_copyable_v<GameState>);
+
 bool operator<(const GameState &lhs, const GameState &rhs);
 bool operator==(const GameState &lhs, const GameState &rhs);
 
@@ -41,6 +47,32 @@ bool operator!= (const Location &lhs, const Location &rhs) ;
 
 std::ostream& operator<< (std::ostream& os, const Location & state) ;
 
+// Storages are also addressed by a flat slot index, in the order of allStorage():
+// free cells first, stacks next and homes last.
+inline constexpr int first_stack_slot = nb_freecells;
+inline constexpr int first_home_slot = nb_freecells + nb_stacks;
+inline constexpr int nb_slots = nb_freecells + nb_stacks + nb_homes;
+
+constexpr int slotFromLoc(Location loc) {
+    switch (loc.cl) {
+        case LocationClass::FreeCells:
+            return loc.id;
+        case LocationClass::Stacks:
+            return first_stack_slot + loc.id;
+        default:
+            return first_home_slot + loc.id;
+    }
+}
+
+constexpr Location locFromSlot(int slot) {
+    if (slot < first_stack_slot)
+        return {LocationClass::FreeCells, slot};
+    else if (slot < first_home_slot)
+        return {LocationClass::Stacks, slot - first_stack_slot};
+    else
+        return {LocationClass::Homes, slot - first_home_slot};
+}
+
 std::ostream& operator<< (std::ostream& os, const GameState & state) ;
 
 void initializeGameState(GameState *gs, std::default_random_engine &rng) ;
@@ -60,6 +92,29 @@ Location locFromPtr(const GameState &gs, const CardStorage *ptr) ;
 
 std::vector<RawMove> safeHomeMoves(const GameState &gs) ;
 
+// Stacks, free cells and homes are interchangeable among themselves, so states differing
+// only in their order are the same position. The canonical form puts occupied free cells first
+// in ascending order, sorts the stacks and places each home at the index of its color.
+GameState canonicalForm(const GameState &gs) ;
+
+// Zobrist hashing of a GameState. Every card contributes a random key given by what it rests on:
+// another card, the bottom of a stack or a free cell. Of the cards at home, only the top ones do.
+// The keys do not depend on which particular stack, free cell or home holds the card,
+// so a state and its canonical form hash equally.
+inline constexpr int zobrist_on_stack_bottom = nb_cards;
+inline constexpr int zobrist_in_free_cell = nb_cards + 1;
+inline constexpr int zobrist_at_home = nb_cards + 2;
+inline constexpr int nb_zobrist_supports = nb_cards + 3;
+
+// support is either an index of the card underneath or one of the zobrist_* constants above
+std::uint64_t zobristKey(Card card, int support) ;
+std::uint64_t zobristHash(const GameState &gs) ;
+
+// Change of the hash caused by moving the top card of from onto to, computed before the move
+std::uint64_t zobristMoveDelta(const GameState &gs, int from_slot, int to_slot) ;
+// change of the hash when the top nb_cards cards of one stack are moved onto another one
+std::uint64_t zobristRunDelta(const GameState &gs, int from_slot, int to_slot, int nb_cards) ;
+
 class InitialStateProducerItf {
 public:
     virtual GameState produce() =0;
@@ -84,4 +139,11 @@ private:
 };
 
 
+namespace std {
+template <>
+struct hash<GameState> {
+    size_t operator()(const GameState &gs) const {return zobristHash(gs);}
+};
+}
+
 #endif
@@ -0,0 +1,301 @@
+#include "search-strategies.h"
+#include "flat-state-set.h"
+#include "open-list.h"
+#include "memusage.h"
+#include "parallel-tree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A generated state on its way to its owner
+struct Message {
+	SearchState state;
+	GlobalId parent;
+	PackedMove move;
+	int g;
+};
+
+struct Batch {
+	Batch *next;
+	std::vector<Message> messages;
+};
+
+// Lock-free inbox with many producers and a single consumer. Batches are pushed onto
+// a Treiber stack and the consumer always takes the whole stack at once, so there is no ABA.
+class Inbox {
+public:
+	~Inbox() {
+		Batch *batch = takeAll();
+		while (batch != nullptr) {
+			Batch *next = batch->next;
+			delete batch;
+			batch = next;
+		}
+	}
+
+	void push(Batch *batch) {
+		batch->next = head_.load(std::memory_order_relaxed);
+		while (!head_.compare_exchange_weak(batch->next, batch, std::memory_order_release, std::memory_order_relaxed))
+			;
+	}
+
+	Batch *takeAll() {
+		return head_.exchange(nullptr, std::memory_order_acquire);
+	}
+
+private:
+	std::atomic<Batch *> head_{nullptr};
+};
+
+// memory is checked once per this many expansions of the first worker, reading RSS is not free
+constexpr int memory_check_period = 256;
+
+struct Shared {
+	Shared(size_t nb_workers, size_t mem_limit, bool first_solution) :
+		inboxes(nb_workers), mem_limit(mem_limit), first_solution(first_solution) {}
+
+	std::vector<Inbox> inboxes;
+
+	// states sent but not received yet, plus states waiting in open lists
+	std::atomic<long long> outstanding{0};
+	std::atomic<bool> abort{false};
+	const size_t mem_limit;
+	const bool first_solution;
+
+	// cost of the best solution found so far, read without locking to prune
+	std::atomic<int> incumbent_cost{INT_MAX};
+	std::mutex incumbent_mutex;
+	GlobalId incumbent_parent = no_parent;
+	PackedMove incumbent_move{};
+
+	void offerSolution(int cost, GlobalId parent, PackedMove move) {
+		std::lock_guard<std::mutex> lock(incumbent_mutex);
+		if (cost < incumbent_cost.load()) {
+			incumbent_parent = parent;
+			incumbent_move = move;
+			incumbent_cost = cost;
+		}
+	}
+
+	// the workers are done, for lack of memory or with a good enough solution
+	bool stopping() const {
+		if (abort.load(std::memory_order_relaxed))
+			return true;
+		return first_solution && incumbent_cost.load(std::memory_order_relaxed) != INT_MAX;
+	}
+};
+
+struct OpenEntry {
+	SearchState state;
+	GlobalId id;
+	int g;
+};
+
+class Worker {
+public:
+	Worker(size_t index, Shared &shared, const AStarHeuristicItf &heuristic, size_t closed_budget, TieBreak tie_break) :
+		index_(index),
+		shared_(shared),
+		heuristic_(heuristic),
+		closed_(closed_budget),
+		open_(tie_break),
+		outgoing_(shared.inboxes.size()) {}
+
+	void run();
+
+	const TreeNode &nodeAt(size_t index) const {return nodes_[index];}
+	ClosedListStats closedStats() const {return closed_.stats();}
+
+private:
+	void receive_();
+	void accept_(Message &message);
+	void expand_(const OpenEntry &entry);
+	void send_(size_t owner, Message &&message);
+	void flush_();
+	void checkMemory_();
+
+	// children are sent in batches of this size at least, unless the worker runs dry
+	static constexpr size_t batch_size = 64;
+
+	size_t index_;
+	Shared &shared_;
+	const AStarHeuristicItf &heuristic_;
+
+	// lowest g each owned state has been reached with
+	FlatStateCosts closed_;
+	BucketOpenList<OpenEntry> open_;
+	std::vector<TreeNode> nodes_;
+	std::vector<std::vector<Message>> outgoing_;
+	MoveBuffer moves_;
+	int until_memory_check_ = memory_check_period;
+	size_t old_memory_ = 0;
+};
+
+void Worker::run() {
+	while (!shared_.stopping()) {
+		receive_();
+
+		if (!open_.empty()) {
+			OpenEntry entry = open_.pop();
+			expand_(entry);
+			// only now, when the children are counted in
+			shared_.outstanding.fetch_sub(1);
+
+			// the closed lists are bounded, but not the open lists and the batches in flight
+			if (index_ == 0 && --until_memory_check_ == 0) {
+				until_memory_check_ = memory_check_period;
+				checkMemory_();
+			}
+		} else {
+			flush_();
+			if (shared_.outstanding.load() == 0)
+				break;
+			std::this_thread::yield();
+		}
+	}
+
+	SearchState::flushCounters();
+}
+
+void Worker::receive_() {
+	Batch *batch = shared_.inboxes[index_].takeAll();
+	while (batch != nullptr) {
+		for (auto &message : batch->messages)
+			accept_(message);
+
+		Batch *next = batch->next;
+		delete batch;
+		batch = next;
+	}
+}
+
+// Stops the search before the memory watcher would, extrapolating the growth like AStarSearch
+void Worker::checkMemory_() {
+	auto taken_memory = getCurrentRSS();
+	size_t growth = taken_memory > old_memory_ ? taken_memory - old_memory_ : 0;
+	if (old_memory_ != 0 && growth * 5 + taken_memory > shared_.mem_limit)
+		shared_.abort = true;
+	old_memory_ = taken_memory;
+}
+
+void Worker::accept_(Message &message) {
+	// states are not expanded in global f order, so a state may come again with a lower g,
+	// it is then opened again
+	if (!closed_.lower(message.state.packed(), message.g)) {
+		if (closed_.full())
+			shared_.abort = true; // the closed list ran out of memory
+		shared_.outstanding.fetch_sub(1);
+		return;
+	}
+
+	double f = message.g + compute_heuristic(message.state, heuristic_);
+	if (f >= shared_.incumbent_cost.load(std::memory_order_relaxed)) {
+		shared_.outstanding.fetch_sub(1);
+		return;
+	}
+
+	GlobalId id = makeGlobalId(index_, nodes_.size());
+	nodes_.push_back({message.parent, message.move});
+	open_.push(f, message.g, {message.state, id, message.g});
+}
+
+void Worker::expand_(const OpenEntry &entry) {
+	// a solution at least as good has been found meanwhile
+	if (entry.g + 1 >= shared_.incumbent_cost.load(std::memory_order_relaxed))
+		return;
+	// superseded by a cheaper arrival of the same state
+	if (closed_.cost(entry.state.packed()) < entry.g)
+		return;
+
+	entry.state.actions(moves_);
+	for (auto move : moves_) {
+		SearchState child = SearchAction(move).execute(entry.state);
+		if (child.isFinal()) {
+			shared_.offerSolution(entry.g + 1, entry.id, move);
+			continue;
+		}
+		if (child.isDeadEnd())
+			continue;
+
+		send_(child.hash() % outgoing_.size(), {child, entry.id, move, entry.g + 1});
+	}
+}
+
+void Worker::send_(size_t owner, Message &&message) {
+	shared_.outstanding.fetch_add(1);
+	if (owner == index_) {
+		accept_(message);
+		return;
+	}
+
+	outgoing_[owner].push_back(std::move(message));
+	if (outgoing_[owner].size() >= batch_size) {
+		shared_.inboxes[owner].push(new Batch{nullptr, std::move(outgoing_[owner])});
+		outgoing_[owner].clear();
+	}
+}
+
+void Worker::flush_() {
+	for (size_t owner = 0; owner < outgoing_.size(); ++owner) {
+		if (outgoing_[owner].empty())
+			continue;
+
+		shared_.inboxes[owner].push(new Batch{nullptr, std::move(outgoing_[owner])});
+		outgoing_[owner].clear();
+	}
+}
+
+}
+
+HDAStarSearch::HDAStarSearch(
+	std::unique_ptr<AStarHeuristicItf> &&heuristic,
+	size_t mem_limit,
+	size_t nb_threads,
+	TieBreak tie_break,
+	bool first_solution
+) :
+        heuristic_(std::move(heuristic)),
+        mem_limit_(mem_limit),
+        nb_threads_(nb_threads),
+        tie_break_(tie_break),
+        first_solution_(first_solution) {
+	if (nb_threads_ == 0)
+		nb_threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::vector<SearchAction> HDAStarSearch::solve(const SearchState &init_state) {
+	closed_stats_ = {};
+	if (init_state.isFinal())
+		return {};
+
+	Shared shared(nb_threads_, mem_limit_, first_solution_);
+	std::vector<std::unique_ptr<Worker>> workers;
+	for (size_t i = 0; i < nb_threads_; ++i)
+		workers.push_back(std::make_unique<Worker>(i, shared, *heuristic_, mem_limit_ / 2 / nb_threads_, tie_break_));
+
+	shared.outstanding = 1;
+	size_t root_owner = init_state.hash() % nb_threads_;
+	shared.inboxes[root_owner].push(new Batch{nullptr, {{init_state, no_parent, PackedMove{}, 0}}});
+
+	std::vector<std::thread> threads;
+	for (auto &worker : workers)
+		threads.emplace_back(&Worker::run, worker.get());
+	for (auto &thread : threads)
+		thread.join();
+
+	for (const auto &worker : workers)
+		closed_stats_ += worker->closedStats();
+
+	if (shared.abort || shared.incumbent_cost == INT_MAX)
+		return {};
+
+	/* Backtracking the result through the arenas of all workers */
+	return pathThroughArenas(workers, shared.incumbent_parent, shared.incumbent_move);
+}
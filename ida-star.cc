@@ -0,0 +1,112 @@
+#include "search-strategies.h"
+
+#include <algorithm>
+#include <limits>
+
+IDAStarSearch::IDAStarSearch(std::unique_ptr<AStarHeuristicItf> &&heuristic, size_t tt_size) :
+        heuristic_(std::move(heuristic)),
+        iteration_(0),
+        nb_transpositions_(0),
+        found_(false) {
+    size_t nb_entries = 1;
+    while (nb_entries * 2 <= tt_size)
+        nb_entries *= 2;
+
+    table_.resize(nb_entries);
+}
+
+std::vector<SearchAction> IDAStarSearch::solve(const SearchState &init_state) {
+	if (init_state.isFinal())
+		return {};
+
+	std::fill(table_.begin(), table_.end(), TableEntry_{0, 0.0, 0, 0});
+	iteration_ = 0;
+
+	SearchState working_state(init_state);
+	double bound = compute_heuristic(working_state, *heuristic_);
+
+	while (true) {
+		++iteration_;
+		found_ = false;
+		path_.clear();
+
+		double next_bound = search_(working_state, 0, bound);
+		if (found_) {
+			std::vector<SearchAction> solution;
+			for (auto move : path_)
+				solution.push_back(SearchAction(move));
+			return solution;
+		}
+
+		// the whole reachable space has been searched
+		if (next_bound == std::numeric_limits<double>::infinity())
+			return {};
+
+		bound = next_bound;
+	}
+}
+
+// Returns the smallest f value exceeding the bound met in the subtree,
+// or the f value of the final state when one has been found.
+double IDAStarSearch::search_(SearchState &state, int g, double bound) {
+	const std::uint64_t hash = state.hash();
+
+	// a hit holds the heuristic value already, backed up or not
+	double h;
+	TableEntry_ &entry = entryFor_(hash);
+	if (entry.hash == hash) {
+		// already searched from no greater depth in this iteration, that visit covers this one.
+		// Its f values are left out here, so the ancestors must not back theirs up.
+		if (entry.iteration == iteration_ && entry.g <= static_cast<std::uint32_t>(g)) {
+			++nb_transpositions_;
+			return std::numeric_limits<double>::infinity();
+		}
+		h = entry.h;
+	} else {
+		h = compute_heuristic(state, *heuristic_);
+	}
+
+	double f = g + h;
+	if (f > bound)
+		return f;
+
+	if (state.isFinal()) {
+		found_ = true;
+		return f;
+	}
+
+	if (state.isDeadEnd())
+		return std::numeric_limits<double>::infinity();
+
+	entry = {hash, h, static_cast<std::uint32_t>(g), iteration_};
+
+	MoveBuffer moves;
+	state.actions(moves);
+	const auto nb_transpositions = nb_transpositions_;
+
+	double next_bound = std::numeric_limits<double>::infinity();
+	for (auto move : moves) {
+		UndoRecord undo;
+		state.apply(move, undo);
+		path_.push_back(move);
+
+		double child_bound = search_(state, g + 1, bound);
+		if (found_)
+			return child_bound;
+
+		path_.pop_back();
+		state.undo(undo);
+		next_bound = std::min(next_bound, child_bound);
+	}
+
+	// an incomplete next_bound could overestimate the distance
+	if (nb_transpositions_ != nb_transpositions)
+		return next_bound;
+
+	// the entry may have been taken over by a colliding state meanwhile
+	TableEntry_ &backed_up = entryFor_(hash);
+	if (backed_up.hash == hash && next_bound != std::numeric_limits<double>::infinity())
+		backed_up.h = std::max(backed_up.h, next_bound - g);
+
+	return next_bound;
+}
@@ -0,0 +1,212 @@
+#include "move-engine.h"
+
+#include <algorithm>
+
+void slotMove(GameState &gs, int from, int to) {
+    std::optional<Card> card;
+    if (from < first_stack_slot)
+        card = gs.free_cells[from].getCard();
+    else if (from < first_home_slot)
+        card = gs.stacks[from - first_stack_slot].getCard();
+    else
+        card = gs.homes[from - first_home_slot].getCard();
+
+    if (to < first_stack_slot)
+        gs.free_cells[to].acceptCard(*card);
+    else if (to < first_home_slot)
+        gs.stacks[to - first_stack_slot].forceCard(*card);
+    else
+        gs.homes[to - first_home_slot].acceptCard(*card);
+}
+
+int orderedRunLength(const WorkStack &stack) {
+    auto cards = stack.storage();
+    if (cards.empty())
+        return 0;
+
+    int length = 1;
+    for (size_t i = cards.size() - 1; i > 0 && WorkStack::canSitOn(cards[i - 1], cards[i]); --i)
+        ++length;
+
+    return length;
+}
+
+int supermoveCapacity(const GameState &gs, bool to_empty_stack) {
+    int empty_cells = 0;
+    for (const auto &fc : gs.free_cells) {
+        if (!fc.topCard().has_value())
+            ++empty_cells;
+    }
+
+    int empty_stacks = 0;
+    for (const auto &stack : gs.stacks) {
+        if (stack.nbCards() == 0)
+            ++empty_stacks;
+    }
+
+    // the target stack can not be used to park cards
+    if (to_empty_stack)
+        --empty_stacks;
+
+    return (empty_cells + 1) << empty_stacks;
+}
+
+int movedCards(const GameState &gs, PackedMove move) {
+    int from = move.from();
+    int to = move.to();
+
+    if (move.isRunToEmpty()) {
+        if (from == to || gs.stacks[to - first_stack_slot].nbCards() != 0)
+            return 0;
+
+        int nb_cards = std::min(orderedRunLength(gs.stacks[from - first_stack_slot]), supermoveCapacity(gs, true));
+        return nb_cards >= 2 ? nb_cards : 0;
+    }
+
+    if (slotMoveLegal(gs, from, to))
+        return 1;
+
+    bool between_stacks = from >= first_stack_slot && to >= first_stack_slot && to < first_home_slot;
+    if (!between_stacks || from == to)
+        return 0;
+
+    // only one card of the run can fit onto the target, find it
+    auto opt_target = gs.stacks[to - first_stack_slot].topCard();
+    if (!opt_target.has_value())
+        return 0;
+
+    auto cards = gs.stacks[from - first_stack_slot].storage();
+    int run = orderedRunLength(gs.stacks[from - first_stack_slot]);
+    int capacity = supermoveCapacity(gs, false);
+    for (int nb_cards = 2; nb_cards <= run && nb_cards <= capacity; ++nb_cards) {
+        if (WorkStack::canSitOn(*opt_target, cards[cards.size() - nb_cards]))
+            return nb_cards;
+    }
+
+    return 0;
+}
+
+void slotMoveRun(GameState &gs, int from, int to, int nb_cards) {
+    if (nb_cards == 1) {
+        slotMove(gs, from, to);
+        return;
+    }
+
+    std::array<Card, max_stack_size> run;
+    auto &source = gs.stacks[from - first_stack_slot];
+    for (int i = nb_cards - 1; i >= 0; --i)
+        run[i] = *source.getCard();
+
+    auto &target = gs.stacks[to - first_stack_slot];
+    for (int i = 0; i < nb_cards; ++i)
+        target.forceCard(run[i]);
+}
+
+void collectSupermoves(const GameState &gs, MoveBuffer &moves) {
+    for (int from = first_stack_slot; from < first_home_slot; ++from) {
+        if (orderedRunLength(gs.stacks[from - first_stack_slot]) < 2)
+            continue;
+
+        for (int to = first_stack_slot; to < first_home_slot; ++to) {
+            if (to == from)
+                continue;
+
+            if (gs.stacks[to - first_stack_slot].nbCards() == 0) {
+                if (movedCards(gs, PackedMove::runToEmpty(from, to)) >= 2)
+                    moves.push(PackedMove::runToEmpty(from, to));
+            } else if (!slotMoveLegal(gs, from, to) && movedCards(gs, PackedMove(from, to)) >= 2) {
+                moves.push(PackedMove(from, to));
+            }
+        }
+    }
+}
+
+namespace {
+
+template <typename Storages>
+int firstEmptySlot(const Storages &storages, int first_slot) {
+    for (size_t i = 0; i < storages.size(); ++i) {
+        if (!storages[i].topCard().has_value())
+            return first_slot + i;
+    }
+
+    return -1;
+}
+
+}
+
+bool isRedundantMove(const GameState &gs, PackedMove move, std::optional<PackedMove> last_move) {
+    int from = move.from();
+    int to = move.to();
+
+    // back onto an emptied stack, a different number of cards might go than came
+    bool to_empty_stack = to >= first_stack_slot && to < first_home_slot && gs.stacks[to - first_stack_slot].nbCards() == 0;
+    if (last_move.has_value() && from == last_move->to() && to == last_move->from() && !to_empty_stack)
+        return true;
+
+    if (to < first_stack_slot) {
+        // the free cells are all alike
+        return from < first_stack_slot || to != firstEmptySlot(gs.free_cells, 0);
+    } else if (to < first_home_slot) {
+        if (gs.stacks[to - first_stack_slot].nbCards() > 0)
+            return false;
+
+        if (from >= first_stack_slot) {
+            int nb_cards = move.isRunToEmpty() ? movedCards(gs, move) : 1;
+            if (gs.stacks[from - first_stack_slot].nbCards() == static_cast<size_t>(nb_cards))
+                return true;
+        }
+        return to != firstEmptySlot(gs.stacks, first_stack_slot);
+    } else {
+        // only aces go to empty homes, any of them would do
+        return !gs.homes[to - first_home_slot].topCard().has_value() && to != firstEmptySlot(gs.homes, first_home_slot);
+    }
+}
+
+bool isCommutedMove(const GameState &gs, PackedMove move, PackedMove last_move) {
+    int from = move.from();
+    int to = move.to();
+
+    // the lower source goes first
+    if (from >= last_move.from())
+        return false;
+    if (to == last_move.from() || to == last_move.to() || from == last_move.to())
+        return false;
+    if (to >= first_home_slot || last_move.to() >= first_home_slot)
+        return false;
+
+    // runs depend on the free cells and empty stacks the other move may take or leave
+    if (move.isRunToEmpty() || !slotMoveLegal(gs, from, to))
+        return false;
+
+    // in the other order the uncovered card would have gone home right away
+    if (from >= first_stack_slot) {
+        auto cards = gs.stacks[from - first_stack_slot].storage();
+        if (cards.size() >= 2 && safeHomeSlotFor(gs, cards[cards.size() - 2]) >= 0)
+            return false;
+    }
+
+    return true;
+}
+
+int safeHomeSlotFor(const GameState &gs, Card card) {
+    auto home_it = findHomeFor(gs, card);
+    if (home_it == gs.homes.end() || !cardCouldGoHome(gs, card))
+        return -1;
+
+    return first_home_slot + (home_it - gs.homes.begin());
+}
+
+std::optional<std::pair<int, int>> findSafeHomeMove(const GameState &gs) {
+    for (int from = 0; from < first_home_slot; ++from) {
+        auto opt_card = topCardAt(gs, from);
+        if (!opt_card.has_value())
+            continue;
+
+        int to = safeHomeSlotFor(gs, *opt_card);
+        if (to >= 0)
+            return std::make_pair(from, to);
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,219 @@
+#ifndef MOVE_ENGINE_H
+#define MOVE_ENGINE_H
+
+#include "game.h"
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// Moves addressed by slot indices. Each slot range maps to a single storage type,
+// so the storages are queried without virtual calls or pointer to location translation.
+
+inline std::optional<Card> topCardAt(const GameState &gs, int slot) {
+    if (slot < first_stack_slot)
+        return gs.free_cells[slot].topCard();
+    else if (slot < first_home_slot)
+        return gs.stacks[slot - first_stack_slot].topCard();
+    else
+        return gs.homes[slot - first_home_slot].topCard();
+}
+
+inline bool slotAccepts(const GameState &gs, int slot, Card card) {
+    if (slot < first_stack_slot)
+        return gs.free_cells[slot].canAccept(card);
+    else if (slot < first_home_slot)
+        return gs.stacks[slot - first_stack_slot].canAccept(card);
+    else
+        return gs.homes[slot - first_home_slot].canAccept(card);
+}
+
+inline bool slotMoveLegal(const GameState &gs, int from, int to) {
+    auto opt_card = topCardAt(gs, from);
+    return opt_card.has_value() && slotAccepts(gs, to, *opt_card);
+}
+
+// moves the top card of from onto to, expects a legal move
+void slotMove(GameState &gs, int from, int to) ;
+
+// Calls visit(from, to) for every legal single card move. Sources come in the order
+// of nonHomes(), destinations in the order of allStorage().
+template <typename Visitor>
+void forEachLegalMove(const GameState &gs, Visitor &&visit) {
+    auto visit_destinations = [&](int from, Card card) {
+        for (int i = 0; i < nb_freecells; ++i) {
+            if (gs.free_cells[i].canAccept(card))
+                visit(from, i);
+        }
+        for (int i = 0; i < nb_stacks; ++i) {
+            if (gs.stacks[i].canAccept(card))
+                visit(from, first_stack_slot + i);
+        }
+        for (int i = 0; i < nb_homes; ++i) {
+            if (gs.homes[i].canAccept(card))
+                visit(from, first_home_slot + i);
+        }
+    };
+
+    for (int i = 0; i < nb_freecells; ++i) {
+        auto opt_card = gs.free_cells[i].topCard();
+        if (opt_card.has_value())
+            visit_destinations(i, *opt_card);
+    }
+    for (int i = 0; i < nb_stacks; ++i) {
+        auto opt_card = gs.stacks[i].topCard();
+        if (opt_card.has_value())
+            visit_destinations(first_stack_slot + i, *opt_card);
+    }
+}
+
+// A move packed into a byte. Moves of a single card, or of the run which fits onto
+// a non-empty stack, are coded as from * nb_slots + to. Homes are never the source
+// of a move, so these codes stay below 192. The rest of the byte codes moves of
+// the longest movable run onto an empty stack, as 192 + from_stack * nb_stacks + to_stack.
+class PackedMove {
+public:
+    PackedMove() = default;
+    constexpr PackedMove(int from, int to) :
+        code_(static_cast<std::uint8_t>(from * nb_slots + to)) {
+        assert(from >= 0 && from < first_home_slot && to >= 0 && to < nb_slots);
+    }
+
+    // both given as slots of stacks
+    static constexpr PackedMove runToEmpty(int from, int to) {
+        PackedMove move{};
+        move.code_ = static_cast<std::uint8_t>(run_to_empty_base + (from - first_stack_slot) * nb_stacks + to - first_stack_slot);
+        return move;
+    }
+
+    constexpr bool isRunToEmpty() const {return code_ >= run_to_empty_base;}
+    constexpr int from() const {
+        return isRunToEmpty() ? first_stack_slot + (code_ - run_to_empty_base) / nb_stacks : code_ / nb_slots;
+    }
+    constexpr int to() const {
+        return isRunToEmpty() ? first_stack_slot + (code_ - run_to_empty_base) % nb_stacks : code_ % nb_slots;
+    }
+    constexpr std::uint8_t code() const {return code_;}
+
+private:
+    static constexpr int run_to_empty_base = first_home_slot * nb_slots;
+
+    std::uint8_t code_;
+};
+
+static_assert(sizeof(PackedMove) == 1);
+static_assert(first_home_slot * nb_slots + nb_stacks * nb_stacks <= 256);
+
+constexpr bool operator==(PackedMove a, PackedMove b) {return a.code() == b.code();}
+constexpr bool operator!=(PackedMove a, PackedMove b) {return a.code() != b.code();}
+
+// upper bound on the number of legal moves in any state, every code at most once
+inline constexpr int max_nb_moves = first_home_slot * nb_slots + nb_stacks * nb_stacks;
+
+// Optional extensions of move generation, carried along by search states
+struct MoveOptions {
+    // also move whole ordered runs between stacks, as if card by card through
+    // the empty free cells and stacks
+    bool supermoves = false;
+    // leave out moves which only lead to a position equivalent to that of another move,
+    // or straight back to the previous one
+    bool prune = false;
+    // partial-order reduction, of two commuting moves only the order with the lower source
+    // comes after the other one
+    bool por = false;
+    // depth of the lookahead proving dead ends, see isDeadEnd(), negative to not look for them
+    int dead_end_depth = -1;
+};
+
+// number of cards on top of the stack forming a run of alternating colors and descending values
+int orderedRunLength(const WorkStack &stack) ;
+
+// how many cards can be moved at once with the help of the empty free cells and stacks
+int supermoveCapacity(const GameState &gs, bool to_empty_stack) ;
+
+// number of cards the move takes, 0 if it is not legal
+int movedCards(const GameState &gs, PackedMove move) ;
+
+// moves the top nb_cards cards of from onto to, expects a legal move
+void slotMoveRun(GameState &gs, int from, int to, int nb_cards) ;
+
+// Fixed-capacity list of moves, meant to be reused between expansions so that
+// generating moves never allocates.
+class MoveBuffer {
+public:
+    void clear() {size_ = 0;}
+    void push(PackedMove move) {
+        assert(size_ < max_nb_moves);
+        moves_[size_++] = move;
+    }
+
+    const PackedMove *begin() const {return moves_.data();}
+    const PackedMove *end() const {return moves_.data() + size_;}
+    size_t size() const {return size_;}
+    bool empty() const {return size_ == 0;}
+    PackedMove operator[](size_t i) const {return moves_[i];}
+
+    // keeps the order of the remaining moves, returns how many were removed
+    template <typename Predicate>
+    int removeIf(Predicate &&pred) {
+        int kept = 0;
+        for (int i = 0; i < size_; ++i) {
+            if (!pred(moves_[i]))
+                moves_[kept++] = moves_[i];
+        }
+
+        int removed = size_ - kept;
+        size_ = kept;
+        return removed;
+    }
+
+private:
+    std::array<PackedMove, max_nb_moves> moves_;
+    int size_ = 0;
+};
+
+// appends the moves of runs of at least two cards between stacks
+void collectSupermoves(const GameState &gs, MoveBuffer &moves) ;
+
+// replaces the content of moves with all legal moves, in the order of forEachLegalMove,
+// followed by the supermoves if enabled
+inline void collectLegalMoves(const GameState &gs, MoveBuffer &moves, const MoveOptions &options = {}) {
+    moves.clear();
+    forEachLegalMove(gs, [&](int from, int to){
+        moves.push(PackedMove(from, to));
+    });
+
+    if (options.supermoves)
+        collectSupermoves(gs, moves);
+}
+
+// The move is legal, but redundant: it moves a card between free cells, a whole stack onto
+// an empty one, or targets an empty storage other than the first empty one of its kind
+// (all of these have an equivalent sibling), or it reverts last_move.
+bool isRedundantMove(const GameState &gs, PackedMove move, std::optional<PackedMove> last_move) ;
+
+// removes the redundant moves, returns their number
+inline int pruneRedundantMoves(const GameState &gs, MoveBuffer &moves, std::optional<PackedMove> last_move) {
+    return moves.removeIf([&](PackedMove move){return isRedundantMove(gs, move, last_move);});
+}
+
+// The single card move commutes with last_move, a single card move which triggered no safe
+// moves to home, and it comes from a lower slot, so playing it before last_move reaches
+// the same position. Commuting moves touch disjoint storages, neither goes home and
+// the card uncovered by move is not safe to send home.
+bool isCommutedMove(const GameState &gs, PackedMove move, PackedMove last_move) ;
+
+// removes the moves commuted with last_move, returns their number
+inline int pruneCommutedMoves(const GameState &gs, MoveBuffer &moves, PackedMove last_move) {
+    return moves.removeIf([&](PackedMove move){return isCommutedMove(gs, move, last_move);});
+}
+
+// slot of the home where the card could be safely moved right away, -1 if there is none
+int safeHomeSlotFor(const GameState &gs, Card card) ;
+
+// the first safe move to home in the order of nonHomes(), as {from, to} slots
+std::optional<std::pair<int, int>> findSafeHomeMove(const GameState &gs) ;
+
+#endif
@@ -0,0 +1,12 @@
+#include "node-arena.h"
+
+#include <algorithm>
+
+std::vector<SearchAction> NodeArena::pathTo(NodeId id) const {
+    std::vector<SearchAction> path;
+    for (; nodes_[id].parent != no_node; id = nodes_[id].parent)
+        path.push_back(SearchAction(nodes_[id].move));
+
+    std::reverse(path.begin(), path.end());
+    return path;
+}
@@ -0,0 +1,42 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include "search-interface.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using NodeId = std::uint32_t;
+inline constexpr NodeId no_node = std::numeric_limits<NodeId>::max();
+
+// Search tree kept in one contiguous array. A node only knows its parent and the move
+// which led from the parent to it, the states themselves travel in the open lists.
+class NodeArena {
+public:
+    struct Node {
+        NodeId parent;
+        PackedMove move;
+    };
+
+    NodeId addRoot() {return add(no_node, PackedMove{});}
+    NodeId add(NodeId parent, PackedMove move) {
+        nodes_.push_back({parent, move});
+        return static_cast<NodeId>(nodes_.size() - 1);
+    }
+
+    const Node &operator[](NodeId id) const {return nodes_[id];}
+    size_t size() const {return nodes_.size();}
+    size_t bytes() const {return nodes_.capacity() * sizeof(Node);}
+    void clear() {nodes_.clear();}
+
+    // actions leading from the root to the given node
+    std::vector<SearchAction> pathTo(NodeId id) const;
+
+private:
+    std::vector<Node> nodes_;
+};
+
+static_assert(sizeof(NodeArena::Node) == 8);
+
+#endif
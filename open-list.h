@@ -0,0 +1,143 @@
+#ifndef OPEN_LIST_H
+#define OPEN_LIST_H
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Order of entries with the same f value
+enum class TieBreak {
+    LowH, // deepest first, i.e. closest to the goal according to the heuristic
+    LowG, // shallowest first
+};
+
+// Open list of A*. With integral f and g values, which is what the bundled heuristics give,
+// entries are kept in buckets indexed by f and then by g, push and pop are O(1) amortized.
+// Inside a single (f, g) bucket the last pushed entry comes out first.
+// The first non-integral (or out of range) value moves everything to a binary heap.
+template <typename Payload>
+class BucketOpenList {
+public:
+    explicit BucketOpenList(TieBreak tie_break) : tie_break_(tie_break) {}
+
+    void push(double f, int g, Payload payload) {
+        ++size_;
+        if (!use_heap_ && !fitsBuckets_(f, g))
+            switchToHeap_();
+
+        if (use_heap_) {
+            heap_.push_back({f, g, std::move(payload)});
+            std::push_heap(heap_.begin(), heap_.end(), HeapOrder_{tie_break_});
+            return;
+        }
+
+        size_t f_index = static_cast<size_t>(f);
+        if (f_index >= buckets_.size()) {
+            buckets_.resize(f_index + 1);
+            min_g_.resize(f_index + 1, std::numeric_limits<size_t>::max());
+        }
+        auto &by_g = buckets_[f_index];
+        if (static_cast<size_t>(g) >= by_g.size())
+            by_g.resize(g + 1);
+
+        by_g[g].push_back(std::move(payload));
+        min_f_ = std::min(min_f_, f_index);
+        min_g_[f_index] = std::min(min_g_[f_index], static_cast<size_t>(g));
+    }
+
+    // expects a non-empty list
+    Payload pop() {
+        assert(size_ > 0);
+        --size_;
+
+        if (use_heap_) {
+            std::pop_heap(heap_.begin(), heap_.end(), HeapOrder_{tie_break_});
+            Payload payload = std::move(heap_.back().payload);
+            heap_.pop_back();
+            return payload;
+        }
+
+        while (trimEmpty_(buckets_[min_f_]))
+            ++min_f_;
+
+        auto &by_g = buckets_[min_f_];
+        if (tie_break_ == TieBreak::LowH) {
+            Payload payload = std::move(by_g.back().back());
+            by_g.back().pop_back();
+            return payload;
+        }
+
+        size_t &min_g = min_g_[min_f_];
+        Payload payload = std::move(by_g[min_g].back());
+        by_g[min_g].pop_back();
+        while (min_g < by_g.size() && by_g[min_g].empty())
+            ++min_g;
+        return payload;
+    }
+
+    bool empty() const {return size_ == 0;}
+    size_t size() const {return size_;}
+    bool usesHeap() const {return use_heap_;}
+
+private:
+    struct Entry_ {
+        double f;
+        int g;
+        Payload payload;
+    };
+
+    // std heaps keep the largest element on top, so this is "comes out later than"
+    struct HeapOrder_ {
+        TieBreak tie_break;
+        bool operator()(const Entry_ &a, const Entry_ &b) const {
+            if (a.f != b.f)
+                return a.f > b.f;
+            return tie_break == TieBreak::LowH ? a.g < b.g : a.g > b.g;
+        }
+    };
+
+    // buckets are allocated up to f, so absurd values go to the heap as well
+    static constexpr double max_bucket_f = 1 << 20;
+
+    static bool fitsBuckets_(double f, int g) {
+        return f >= 0 && f < max_bucket_f && f == std::floor(f) && g >= 0 && g < max_bucket_f;
+    }
+
+    // drops the emptied g buckets from the top, the last one left is non-empty,
+    // returns whether nothing is left
+    static bool trimEmpty_(std::vector<std::vector<Payload>> &by_g) {
+        while (!by_g.empty() && by_g.back().empty())
+            by_g.pop_back();
+        return by_g.empty();
+    }
+
+    void switchToHeap_() {
+        use_heap_ = true;
+        for (size_t f = 0; f < buckets_.size(); ++f) {
+            for (size_t g = 0; g < buckets_[f].size(); ++g) {
+                for (auto &payload : buckets_[f][g])
+                    heap_.push_back({static_cast<double>(f), static_cast<int>(g), std::move(payload)});
+            }
+        }
+        buckets_.clear();
+        min_g_.clear();
+        std::make_heap(heap_.begin(), heap_.end(), HeapOrder_{tie_break_});
+    }
+
+    TieBreak tie_break_;
+    size_t size_ = 0;
+
+    std::vector<std::vector<std::vector<Payload>>> buckets_;
+    size_t min_f_ = 0;
+    // lowest non-empty g of every f bucket, past its end once it is empty; kept for TieBreak::LowG
+    std::vector<size_t> min_g_;
+
+    bool use_heap_ = false;
+    std::vector<Entry_> heap_;
+};
+
+#endif
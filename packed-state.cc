@@ -0,0 +1,101 @@
+#include "packed-state.h"
+
+PackedState packState(const GameState &gs) {
+    std::array<std::uint8_t, nb_cards> supports;
+    supports.fill(packed_card_absent);
+
+    for (const auto &home : gs.homes) {
+        auto opt_top = home.topCard();
+        if (!opt_top.has_value())
+            continue;
+
+        for (int value = 1; value <= opt_top->value(); ++value)
+            supports[Card(opt_top->color(), value).index()] = zobrist_at_home;
+    }
+
+    for (const auto &fc : gs.free_cells) {
+        auto opt_card = fc.topCard();
+        if (opt_card.has_value())
+            supports[opt_card->index()] = zobrist_in_free_cell;
+    }
+
+    for (const auto &stack : gs.stacks) {
+        int support = zobrist_on_stack_bottom;
+        for (const auto &card : stack.storage()) {
+            supports[card.index()] = support;
+            support = card.index();
+        }
+    }
+
+    PackedState packed{};
+    for (int i = 0; i < nb_cards; ++i) {
+        int bit = i * PackedState::bits_per_card;
+        std::uint64_t support = supports[i];
+        packed.words[bit / 64] |= support << (bit % 64);
+        if (bit % 64 + PackedState::bits_per_card > 64)
+            packed.words[bit / 64 + 1] |= support >> (64 - bit % 64);
+    }
+
+    return packed;
+}
+
+GameState unpackState(const PackedState &packed) {
+    std::array<int, nb_cards> supports;
+    for (int i = 0; i < nb_cards; ++i) {
+        int bit = i * PackedState::bits_per_card;
+        std::uint64_t support = packed.words[bit / 64] >> (bit % 64);
+        if (bit % 64 + PackedState::bits_per_card > 64)
+            support |= packed.words[bit / 64 + 1] << (64 - bit % 64);
+        supports[i] = support & packed_card_absent;
+    }
+
+    GameState gs;
+
+    // cards are visited in ascending order, so homes get filled from Aces up
+    // and free cells end up sorted
+    std::array<int, nb_cards> card_above;
+    card_above.fill(-1);
+    size_t nb_cell_cards = 0;
+    size_t nb_stack_bottoms = 0;
+    for (int i = 0; i < nb_cards; ++i) {
+        Card card = Card::fromIndex(i);
+        if (supports[i] == zobrist_at_home) {
+            gs.homes[static_cast<int>(card.color())].acceptCard(card);
+        } else if (supports[i] == zobrist_in_free_cell) {
+            gs.free_cells[nb_cell_cards++].acceptCard(card);
+        } else if (supports[i] == zobrist_on_stack_bottom) {
+            gs.stacks[nb_stack_bottoms++].forceCard(card);
+        } else if (supports[i] < nb_cards) {
+            card_above[supports[i]] = i;
+        }
+    }
+
+    for (size_t i = 0; i < nb_stack_bottoms; ++i) {
+        for (int above = card_above[gs.stacks[i].topCard()->index()]; above >= 0; above = card_above[above])
+            gs.stacks[i].forceCard(Card::fromIndex(above));
+    }
+
+    return canonicalForm(gs);
+}
+
+bool operator==(const PackedState &lhs, const PackedState &rhs) {
+    return lhs.words == rhs.words;
+}
+
+bool operator!=(const PackedState &lhs, const PackedState &rhs) {
+    return !(lhs == rhs);
+}
+
+bool operator<(const PackedState &lhs, const PackedState &rhs) {
+    return lhs.words < rhs.words;
+}
+
+std::uint64_t packedStateHash(const PackedState &packed) {
+    std::uint64_t hash = 0;
+    for (auto word : packed.words) {
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 29;
+    }
+
+    return hash;
+}
@@ -0,0 +1,44 @@
+#ifndef PACKED_STATE_H
+#define PACKED_STATE_H
+
+#include "game.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+// Compact key of a position, fit for closed lists.
+// For every card, 6 bits tell what it rests on: the index of the card underneath,
+// the bottom of a stack, a free cell or a home (using the zobrist_* support codes).
+// The order of stacks, free cells and homes is thus forgotten,
+// a key identifies the canonical form of a GameState.
+struct PackedState {
+    static constexpr int bits_per_card = 6;
+    static constexpr int nb_words = (nb_cards * bits_per_card + 63) / 64;
+
+    std::array<std::uint64_t, nb_words> words;
+};
+
+static_assert(sizeof(PackedState) == 40);
+
+// support code of cards not present in the state at all, e.g. in hand-crafted test positions
+inline constexpr int packed_card_absent = (1 << PackedState::bits_per_card) - 1;
+
+PackedState packState(const GameState &gs) ;
+// Restores the position in its canonical form
+GameState unpackState(const PackedState &packed) ;
+
+bool operator==(const PackedState &lhs, const PackedState &rhs) ;
+bool operator!=(const PackedState &lhs, const PackedState &rhs) ;
+bool operator<(const PackedState &lhs, const PackedState &rhs) ;
+
+std::uint64_t packedStateHash(const PackedState &packed) ;
+
+namespace std {
+template <>
+struct hash<PackedState> {
+    size_t operator()(const PackedState &packed) const {return packedStateHash(packed);}
+};
+}
+
+#endif
@@ -0,0 +1,189 @@
+#include "search-strategies.h"
+#include "flat-state-set.h"
+#include "parallel-tree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Task {
+	SearchState state;
+	GlobalId id;
+	int depth;
+};
+
+struct Shared {
+	explicit Shared(size_t mem_limit) : closed(mem_limit) {}
+
+	ShardedStateSet closed;
+
+	// states waiting in deques or being expanded
+	std::atomic<long long> outstanding{0};
+	std::atomic<bool> stop{false};
+
+	std::mutex solution_mutex;
+	bool solved = false;
+	GlobalId solution_parent = no_parent;
+	PackedMove solution_move{};
+};
+
+class Worker {
+public:
+	Worker(size_t index, Shared &shared, std::vector<std::unique_ptr<Worker>> &workers, int depth_limit) :
+		index_(index),
+		shared_(shared),
+		workers_(workers),
+		depth_limit_(depth_limit) {}
+
+	void run();
+	void push(Task &&task);
+	GlobalId addRoot() {
+		nodes_.push_back({no_parent, PackedMove{}});
+		return makeGlobalId(index_, nodes_.size() - 1);
+	}
+
+	const TreeNode &nodeAt(size_t index) const {return nodes_[index];}
+
+private:
+	std::optional<Task> popOwn_();
+	std::optional<Task> stealShallowest_();
+	void expand_(const Task &task);
+
+	size_t index_;
+	Shared &shared_;
+	std::vector<std::unique_ptr<Worker>> &workers_;
+	int depth_limit_;
+
+	// the owner works on the back, thieves take from the front
+	std::mutex deque_mutex_;
+	std::deque<Task> deque_;
+
+	std::vector<TreeNode> nodes_;
+	MoveBuffer moves_;
+};
+
+void Worker::run() {
+	while (!shared_.stop.load(std::memory_order_relaxed)) {
+		std::optional<Task> task = popOwn_();
+		if (!task.has_value())
+			task = stealShallowest_();
+
+		if (task.has_value()) {
+			expand_(*task);
+			// only now, when the children are counted in
+			shared_.outstanding.fetch_sub(1);
+		} else {
+			if (shared_.outstanding.load() == 0)
+				break;
+			std::this_thread::yield();
+		}
+	}
+
+	SearchState::flushCounters();
+}
+
+void Worker::push(Task &&task) {
+	shared_.outstanding.fetch_add(1);
+	std::lock_guard<std::mutex> lock(deque_mutex_);
+	deque_.push_back(std::move(task));
+}
+
+std::optional<Task> Worker::popOwn_() {
+	std::lock_guard<std::mutex> lock(deque_mutex_);
+	if (deque_.empty())
+		return std::nullopt;
+
+	Task task = std::move(deque_.back());
+	deque_.pop_back();
+	return task;
+}
+
+std::optional<Task> Worker::stealShallowest_() {
+	for (size_t i = 1; i < workers_.size(); ++i) {
+		Worker &victim = *workers_[(index_ + i) % workers_.size()];
+		std::lock_guard<std::mutex> lock(victim.deque_mutex_);
+		if (victim.deque_.empty())
+			continue;
+
+		Task task = std::move(victim.deque_.front());
+		victim.deque_.pop_front();
+		return task;
+	}
+
+	return std::nullopt;
+}
+
+void Worker::expand_(const Task &task) {
+	if (task.depth >= depth_limit_)
+		return; // skipping the node expansion
+
+	task.state.actions(moves_);
+	for (auto move : moves_) {
+		auto new_state = SearchAction(move).execute(task.state);
+		if (!shared_.closed.insert(new_state.packed())) {
+			if (shared_.closed.full())
+				shared_.stop = true; // the closed list ran out of memory
+			continue;
+		}
+
+		if (new_state.isFinal()) {
+			std::lock_guard<std::mutex> lock(shared_.solution_mutex);
+			if (!shared_.solved) {
+				shared_.solved = true;
+				shared_.solution_parent = task.id;
+				shared_.solution_move = move;
+			}
+			shared_.stop = true;
+			return;
+		}
+		if (new_state.isDeadEnd())
+			continue;
+
+		GlobalId id = makeGlobalId(index_, nodes_.size());
+		nodes_.push_back({task.id, move});
+		push({new_state, id, task.depth + 1});
+	}
+}
+
+}
+
+ParallelDepthFirstSearch::ParallelDepthFirstSearch(int depth_limit, size_t mem_limit, size_t nb_threads) :
+        depth_limit_(depth_limit),
+        mem_limit_(mem_limit),
+        nb_threads_(nb_threads) {
+	if (nb_threads_ == 0)
+		nb_threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::vector<SearchAction> ParallelDepthFirstSearch::solve(const SearchState &init_state) {
+	closed_stats_ = {};
+	if (init_state.isFinal())
+		return {};
+
+	Shared shared(mem_limit_ / 2);
+	std::vector<std::unique_ptr<Worker>> workers;
+	for (size_t i = 0; i < nb_threads_; ++i)
+		workers.push_back(std::make_unique<Worker>(i, shared, workers, depth_limit_));
+
+	workers[0]->push({init_state, workers[0]->addRoot(), 0});
+
+	std::vector<std::thread> threads;
+	for (auto &worker : workers)
+		threads.emplace_back(&Worker::run, worker.get());
+	for (auto &thread : threads)
+		thread.join();
+
+	closed_stats_ = shared.closed.stats();
+	if (!shared.solved)
+		return {};
+
+	/* Backtracking the result through the arenas of all workers */
+	return pathThroughArenas(workers, shared.solution_parent, shared.solution_move);
+}
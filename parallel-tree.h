@@ -0,0 +1,43 @@
+#ifndef PARALLEL_TREE_H
+#define PARALLEL_TREE_H
+
+#include "search-interface.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Search tree split over per-thread arenas. The upper half of a node id tells
+// the thread whose arena holds the node, the lower half the index in that arena.
+using GlobalId = std::uint64_t;
+inline constexpr GlobalId no_parent = std::numeric_limits<GlobalId>::max();
+
+inline GlobalId makeGlobalId(size_t thread, size_t index) {
+	return static_cast<GlobalId>(thread) << 32 | index;
+}
+
+struct TreeNode {
+	GlobalId parent;
+	PackedMove move;
+};
+
+// Actions from the root to the state reached by last_move from the given node.
+// Arena is anything whose nodeAt(index) gives the TreeNode, arenas are indexed by thread.
+template <typename Arenas>
+std::vector<SearchAction> pathThroughArenas(const Arenas &arenas, GlobalId parent, PackedMove last_move) {
+	std::vector<SearchAction> path{SearchAction(last_move)};
+	GlobalId id = parent;
+	while (true) {
+		const TreeNode &node = arenas[id >> 32]->nodeAt(id & 0xffffffff);
+		if (node.parent == no_parent)
+			break;
+		path.push_back(SearchAction(node.move));
+		id = node.parent;
+	}
+
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+#endif
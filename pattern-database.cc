@@ -0,0 +1,307 @@
+#include "pattern-database.h"
+
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__unix) || defined(unix) || (defined(__APPLE__) && defined(__MACH__))
+#define PATTERN_DATABASE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr std::uint8_t unknown_distance = 255;
+
+// places of a pattern card, see PatternSpec
+constexpr int place_home = 0;
+constexpr int place_aside = 1;
+constexpr int place_on_first = 2;
+
+constexpr int max_pattern_size = king_value;
+
+// the low pattern takes the ranks up to this one, the high pattern the rest
+constexpr int low_last_rank = 6;
+
+// File layout: the header, one record per pattern, then the tables one after another
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t nb_patterns;
+};
+
+struct FilePattern {
+    std::int32_t first_rank;
+    std::int32_t last_rank;
+};
+
+constexpr char file_magic[8] = {'F', 'C', '-', 'P', 'D', 'B', '\0', '\0'};
+constexpr std::uint32_t file_version = 1;
+
+size_t tablesOffset(size_t nb_patterns) {
+    return sizeof(FileHeader) + nb_patterns * sizeof(FilePattern);
+}
+
+}
+
+size_t PatternSpec::tableSize() const {
+    size_t size = 1;
+    for (int i = 0; i < rankCount(); ++i)
+        size *= base();
+
+    return size;
+}
+
+std::vector<std::uint8_t> computePatternTable(const PatternSpec &spec) {
+    const int n = spec.rankCount();
+    const size_t base = spec.base();
+
+    std::array<size_t, max_pattern_size> weights;
+    weights[0] = 1;
+    for (int i = 1; i < n; ++i)
+        weights[i] = weights[i - 1] * base;
+
+    std::vector<std::uint8_t> distances(spec.tableSize(), unknown_distance);
+    std::vector<std::uint32_t> queue;
+
+    // all cards home
+    distances[0] = 0;
+    queue.push_back(0);
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        size_t index = queue[head];
+        std::uint8_t next_distance = distances[index] + 1;
+
+        std::array<int, max_pattern_size> places;
+        std::array<bool, max_pattern_size> covered{};
+        size_t rest = index;
+        for (int i = 0; i < n; ++i) {
+            places[i] = rest % base;
+            rest /= base;
+        }
+        for (int i = 0; i < n; ++i) {
+            if (places[i] >= place_on_first)
+                covered[places[i] - place_on_first] = true;
+        }
+
+        auto visit = [&](size_t predecessor) {
+            if (distances[predecessor] == unknown_distance) {
+                distances[predecessor] = next_distance;
+                queue.push_back(predecessor);
+            }
+        };
+        // c could have come from resting on the uncovered card j
+        auto visitFromAbove = [&](int c) {
+            for (int j = 0; j < n; ++j) {
+                if (j != c && places[j] != place_home && !covered[j])
+                    visit(index + (place_on_first + j - places[c]) * weights[c]);
+            }
+        };
+
+        // the last card sent home came from aside or from another card
+        int nb_home = 0;
+        while (nb_home < n && places[nb_home] == place_home)
+            ++nb_home;
+        if (nb_home > 0) {
+            int c = nb_home - 1;
+            visit(index + (place_aside - place_home) * weights[c]);
+            visitFromAbove(c);
+        }
+
+        // a card aside could have been put there from another card
+        for (int c = nb_home; c < n; ++c) {
+            if (places[c] == place_aside && !covered[c])
+                visitFromAbove(c);
+        }
+    }
+
+    return distances;
+}
+
+// The tables, either mapped from a file or held in memory
+class PatternDatabaseHeuristic::Storage_ {
+public:
+    explicit Storage_(std::vector<std::uint8_t> bytes) :
+        bytes_(std::move(bytes)), data_(bytes_.data()), size_(bytes_.size()) {}
+    ~Storage_() {
+#ifdef PATTERN_DATABASE_MMAP
+        if (mapped_)
+            munmap(const_cast<std::uint8_t *>(data_), size_);
+#endif
+    }
+    Storage_(const Storage_ &) = delete;
+    Storage_ &operator=(const Storage_ &) = delete;
+
+    // nullptr if the file can not be read
+    static std::unique_ptr<Storage_> load(const std::string &path) {
+#ifdef PATTERN_DATABASE_MMAP
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        struct stat info;
+        void *address = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+            address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED)
+            return nullptr;
+
+        std::unique_ptr<Storage_> storage(new Storage_({}));
+        storage->data_ = static_cast<const std::uint8_t *>(address);
+        storage->size_ = info.st_size;
+        storage->mapped_ = true;
+        return storage;
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return nullptr;
+
+        std::vector<std::uint8_t> bytes{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        return std::make_unique<Storage_>(std::move(bytes));
+#endif
+    }
+
+    const std::uint8_t *data() const {return data_;}
+    size_t size() const {return size_;}
+
+private:
+    std::vector<std::uint8_t> bytes_;
+    const std::uint8_t *data_;
+    size_t size_;
+    bool mapped_ = false;
+};
+
+const std::vector<PatternSpec> &PatternDatabaseHeuristic::patterns() {
+    static const std::vector<PatternSpec> specs{{1, low_last_rank}, {low_last_rank + 1, king_value}};
+    return specs;
+}
+
+namespace {
+
+// the content matches the patterns in use
+bool fitsPatterns(const std::uint8_t *data, size_t size, const std::vector<PatternSpec> &specs) {
+    size_t expected_size = tablesOffset(specs.size());
+    for (const auto &spec : specs)
+        expected_size += spec.tableSize();
+    if (size != expected_size)
+        return false;
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0 ||
+            header.version != file_version || header.nb_patterns != specs.size())
+        return false;
+
+    for (size_t i = 0; i < specs.size(); ++i) {
+        FilePattern pattern;
+        std::memcpy(&pattern, data + sizeof(header) + i * sizeof(pattern), sizeof(pattern));
+        if (pattern.first_rank != specs[i].first_rank || pattern.last_rank != specs[i].last_rank)
+            return false;
+    }
+
+    return true;
+}
+
+std::vector<std::uint8_t> buildFile(const std::vector<PatternSpec> &specs) {
+    std::vector<std::uint8_t> bytes(tablesOffset(specs.size()));
+
+    FileHeader header;
+    std::memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = file_version;
+    header.nb_patterns = specs.size();
+    std::memcpy(bytes.data(), &header, sizeof(header));
+
+    for (size_t i = 0; i < specs.size(); ++i) {
+        FilePattern pattern{specs[i].first_rank, specs[i].last_rank};
+        std::memcpy(bytes.data() + sizeof(header) + i * sizeof(pattern), &pattern, sizeof(pattern));
+
+        auto table = computePatternTable(specs[i]);
+        bytes.insert(bytes.end(), table.begin(), table.end());
+    }
+
+    return bytes;
+}
+
+}
+
+PatternDatabaseHeuristic::PatternDatabaseHeuristic(const std::string &path) {
+    const auto &specs = patterns();
+
+    if (!path.empty()) {
+        storage_ = Storage_::load(path);
+        if (storage_ && !fitsPatterns(storage_->data(), storage_->size(), specs))
+            storage_.reset();
+    }
+
+    if (!storage_) {
+        storage_ = std::make_unique<Storage_>(buildFile(specs));
+
+        if (!path.empty()) {
+            std::ofstream out(path, std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char *>(storage_->data()), storage_->size());
+            if (!out)
+                std::cerr << "Could not write the pattern database to '" << path << "'\n";
+        }
+    }
+
+    const std::uint8_t *table = storage_->data() + tablesOffset(specs.size());
+    for (const auto &spec : specs) {
+        tables_.push_back(table);
+        table += spec.tableSize();
+    }
+}
+
+PatternDatabaseHeuristic::~PatternDatabaseHeuristic() = default;
+
+double PatternDatabaseHeuristic::distanceLowerBound(const GameState &state) const {
+    const auto &specs = patterns();
+
+    // place of every card, those neither home nor in a stack are aside,
+    // like the cards in the free cells (or missing from hand-crafted positions)
+    std::array<std::uint8_t, nb_cards> places;
+    places.fill(place_aside);
+    for (const auto &home : state.homes) {
+        auto opt_top = home.topCard();
+        for (int rank = 1; opt_top.has_value() && rank <= opt_top->value(); ++rank)
+            places[Card(opt_top->color(), rank).index()] = place_home;
+    }
+
+    for (const auto &stack : state.stacks) {
+        // rank of the nearest card below of the same suit and pattern, 0 if none
+        std::array<std::array<std::uint8_t, 2>, nb_colors> below{};
+        for (auto card : stack.storage()) {
+            int pattern = card.value() <= low_last_rank ? 0 : 1;
+            auto &below_rank = below[static_cast<int>(card.color())][pattern];
+
+            if (below_rank == 0)
+                places[card.index()] = place_aside;
+            else
+                places[card.index()] = place_on_first + below_rank - specs[pattern].first_rank;
+            below_rank = card.value();
+        }
+    }
+
+    int distance = 0;
+    for (auto color : colors_list) {
+        for (size_t pattern = 0; pattern < specs.size(); ++pattern) {
+            const auto &spec = specs[pattern];
+
+            size_t index = 0;
+            for (int rank = spec.last_rank; rank >= spec.first_rank; --rank)
+                index = index * spec.base() + places[Card(color, rank).index()];
+
+            // the home cards make a prefix and the cards form chains, so the state is known
+            assert(tables_[pattern][index] != unknown_distance);
+            distance += tables_[pattern][index];
+        }
+    }
+
+    return distance;
+}
@@ -0,0 +1,52 @@
+#ifndef PATTERN_DATABASE_H
+#define PATTERN_DATABASE_H
+
+#include "search-strategies.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Abstraction over the cards of ranks first_rank to last_rank of a single suit.
+// Of the rest of the position, only which pattern card lies nearest below each pattern
+// card in its stack is kept. A pattern card goes home once it is uncovered and the lower
+// pattern cards are home, or it is moved aside onto anything else. Other cards never stand
+// in the way, so the abstract distance is a lower bound on the moves of the pattern cards.
+// Every card of the pattern is at one of rank_count + 2 places (home, aside, or on one of
+// the other pattern cards), the tables are indexed by these places in base rank_count + 2.
+struct PatternSpec {
+    int first_rank;
+    int last_rank;
+
+    int rankCount() const {return last_rank - first_rank + 1;}
+    int base() const {return rankCount() + 2;}
+    size_t tableSize() const;
+};
+
+// Exact distances to all cards home of every abstract state, by a breadth-first search
+// backwards from the goal. States which can not occur in a game are left at 255.
+std::vector<std::uint8_t> computePatternTable(const PatternSpec &spec) ;
+
+// Sum over the suits of the distances of two patterns, the low ranks and the high ranks.
+// As in nb_not_home, every card not home counts a move, plus a move for every card
+// which has to be put aside before a lower card of its suit below it can go home.
+// A lookup is a single pass over the cards and two table reads per suit.
+class PatternDatabaseHeuristic : public AStarHeuristicItf {
+public:
+    // Tables are read from path (memory-mapped where possible). When path is empty,
+    // missing or does not fit, they are computed, and written to path if there is one.
+    explicit PatternDatabaseHeuristic(const std::string &path = "");
+    ~PatternDatabaseHeuristic() override;
+
+    double distanceLowerBound(const GameState &state) const override;
+
+    static const std::vector<PatternSpec> &patterns();
+
+private:
+    class Storage_;
+    std::unique_ptr<Storage_> storage_;
+    std::vector<const std::uint8_t *> tables_;
+};
+
+#endif
@@ -0,0 +1,185 @@
+#include "search-strategies.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Runs the walks taken by one thread, with buffers kept from walk to walk
+class Walker {
+public:
+	Walker(const SearchState &init_state, const AStarHeuristicItf *heuristic, double bias, size_t max_depth) :
+		init_state_(init_state),
+		heuristic_(heuristic),
+		bias_(bias),
+		max_depth_(max_depth) {}
+
+	// Walk number index, fills path on success. Gives up once a walk with a lower index succeeded.
+	bool walk(std::uint64_t seed, size_t index, const std::atomic<size_t> &winner, std::vector<PackedMove> &path);
+
+private:
+	std::optional<PackedMove> pickMove_(const SearchState &state, std::mt19937_64 &rng, SearchState &next);
+
+	const SearchState &init_state_;
+	const AStarHeuristicItf *heuristic_;
+	double bias_;
+	size_t max_depth_;
+
+	MoveBuffer moves_;
+	std::vector<PackedMove> candidates_;
+	std::vector<SearchState> children_;
+	std::vector<double> weights_;
+};
+
+bool Walker::walk(std::uint64_t seed, size_t index, const std::atomic<size_t> &winner, std::vector<PackedMove> &path) {
+	std::seed_seq seq{
+		static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32),
+		static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(static_cast<std::uint64_t>(index) >> 32),
+	};
+	std::mt19937_64 rng(seq);
+
+	path.clear();
+	SearchState state(init_state_);
+	for (size_t depth = 0; depth < max_depth_; ++depth) {
+		if (winner.load(std::memory_order_relaxed) < index)
+			return false;
+
+		state.actions(moves_);
+		// on a dead end
+		if (moves_.empty())
+			return false;
+
+		SearchState next(state);
+		auto move = pickMove_(state, rng, next);
+		// all children are dead ends
+		if (!move.has_value())
+			return false;
+
+		path.push_back(*move);
+		state = next;
+
+		if (state.isFinal())
+			return true;
+	}
+
+	return false;
+}
+
+// Uniformly random, or a softmax over the heuristic values of the children.
+// A child reaching the goal is taken right away, dead ends never. Nothing if all are dead ends.
+std::optional<PackedMove> Walker::pickMove_(const SearchState &state, std::mt19937_64 &rng, SearchState &next) {
+	if (heuristic_ == nullptr) {
+		// draws until a child is not a dead end, so only the drawn children are checked
+		candidates_.assign(moves_.begin(), moves_.end());
+		while (!candidates_.empty()) {
+			std::uniform_int_distribution<size_t> uniform(0, candidates_.size() - 1);
+			size_t picked = uniform(rng);
+			PackedMove move = candidates_[picked];
+			next = SearchAction(move).execute(state);
+			if (!next.isDeadEnd())
+				return move;
+
+			candidates_[picked] = candidates_.back();
+			candidates_.pop_back();
+		}
+		return std::nullopt;
+	}
+
+	candidates_.clear();
+	children_.clear();
+	weights_.clear();
+	for (auto move : moves_) {
+		SearchState child = SearchAction(move).execute(state);
+		if (child.isFinal()) {
+			next = child;
+			return move;
+		}
+		if (child.isDeadEnd())
+			continue;
+
+		candidates_.push_back(move);
+		children_.push_back(child);
+		weights_.push_back(compute_heuristic(child, *heuristic_));
+	}
+	if (children_.empty())
+		return std::nullopt;
+
+	double best_h = *std::min_element(weights_.begin(), weights_.end());
+	for (auto &weight : weights_)
+		weight = std::exp(-bias_ * (weight - best_h));
+
+	std::discrete_distribution<size_t> softmax(weights_.begin(), weights_.end());
+	size_t picked = softmax(rng);
+	next = children_[picked];
+	return candidates_[picked];
+}
+
+}
+
+RolloutSearch::RolloutSearch(
+	std::unique_ptr<AStarHeuristicItf> &&heuristic,
+	size_t nb_rollouts,
+	size_t max_depth,
+	std::uint64_t seed,
+	double bias,
+	size_t nb_threads
+) :
+        heuristic_(std::move(heuristic)),
+        nb_rollouts_(nb_rollouts),
+        max_depth_(max_depth),
+        seed_(seed),
+        bias_(bias),
+        nb_threads_(nb_threads) {
+	if (nb_threads_ == 0)
+		nb_threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::vector<SearchAction> RolloutSearch::solve(const SearchState &init_state) {
+	if (init_state.isFinal())
+		return {};
+
+	const AStarHeuristicItf *heuristic = bias_ > 0 ? heuristic_.get() : nullptr;
+
+	// walks are handed out by increasing index, the lowest successful one wins
+	std::atomic<size_t> next_rollout{0};
+	std::atomic<size_t> winner{nb_rollouts_};
+	std::mutex solution_mutex;
+	std::vector<PackedMove> solution;
+
+	auto work = [&]() {
+		Walker walker(init_state, heuristic, bias_, max_depth_);
+		std::vector<PackedMove> path;
+
+		size_t index;
+		while ((index = next_rollout.fetch_add(1)) < winner.load()) {
+			if (!walker.walk(seed_, index, winner, path))
+				continue;
+
+			std::lock_guard<std::mutex> lock(solution_mutex);
+			if (index < winner.load()) {
+				winner = index;
+				solution = path;
+			}
+		}
+
+		SearchState::flushCounters();
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < nb_threads_; ++i)
+		threads.emplace_back(work);
+	for (auto &thread : threads)
+		thread.join();
+
+	std::vector<SearchAction> actions;
+	for (auto move : solution)
+		actions.push_back(SearchAction(move));
+
+	return actions;
+}
@@ -1,50 +1,142 @@
 #include "search-interface.h"
 #include "game.h"
+#include "move-engine.h"
+#include "dead-ends.h"
 
 #include <cassert>
-#include <algorithm>
 
 
 unsigned long long SearchState::nbExpanded() {
-    return SearchState::nb_expanded;
+    return SearchState::nb_expanded_flushed.load() + SearchState::nb_expanded;
+}
+
+unsigned long long SearchState::nbPruned() {
+    return SearchState::nb_pruned_flushed.load() + SearchState::nb_pruned;
+}
+
+unsigned long long SearchState::nbDeadEnds() {
+    return SearchState::nb_dead_ends_flushed.load() + SearchState::nb_dead_ends;
+}
+
+unsigned long long SearchState::nbEvaluated() {
+    return SearchState::nb_evaluated_flushed.load() + SearchState::nb_evaluated;
+}
+
+void SearchState::flushCounters() {
+    SearchState::nb_expanded_flushed += SearchState::nb_expanded;
+    SearchState::nb_expanded = 0;
+    SearchState::nb_pruned_flushed += SearchState::nb_pruned;
+    SearchState::nb_pruned = 0;
+    SearchState::nb_dead_ends_flushed += SearchState::nb_dead_ends;
+    SearchState::nb_dead_ends = 0;
+    SearchState::nb_evaluated_flushed += SearchState::nb_evaluated;
+    SearchState::nb_evaluated = 0;
 }
 
 bool operator<(const SearchState &a, const SearchState &b) {
     return a.state_ < b.state_;
 }
 
+bool operator==(const SearchState &a, const SearchState &b) {
+    return a.hash_ == b.hash_ && a.state_ == b.state_;
+}
+
 SearchState SearchAction::execute(const SearchState& state) const {
 	SearchState new_state(state);
-	bool succeeded = new_state.execute(from_, to_);
+	bool succeeded = new_state.execute(move_);
 	assert(succeeded);
 
 	return new_state;
 }
 
 bool SearchState::execute(Location from, Location to) {
-	auto from_ptr = ptrFromLoc(state_, from);
-	auto to_ptr = ptrFromLoc(state_, to);
+	// cards never leave the homes
+	if (from.cl == LocationClass::Homes)
+		return false;
 
-	if (!moveLegal(from_ptr, to_ptr))
+	return execute(PackedMove(slotFromLoc(from), slotFromLoc(to)));
+}
+
+bool SearchState::execute(PackedMove move) {
+	int nb_cards = movedCards(state_, move);
+	if (nb_cards == 0)
 		return false;
 
-	move(const_cast<CardStorage *>(from_ptr), const_cast<CardStorage *>(to_ptr));
+	moveRun_(move.from(), move.to(), nb_cards);
 
-	runSafeMoves_();
+	bool made_safe_moves = runSafeMoves_();
+	reversible_move_ = made_safe_moves ? std::nullopt : std::optional<PackedMove>(move);
+	reversible_nb_cards_ = nb_cards;
 
     SearchState::nb_expanded++;
 
 	return true;
 }
 
-void SearchState::runSafeMoves_() {
-	std::vector<RawMove> safe_moves;
-	while ((safe_moves = safeHomeMoves(state_)), safe_moves.size() > 0) {
-		const CardStorage *from = safe_moves[0].first;
-		const CardStorage *to = safe_moves[0].second;
+bool SearchState::apply(PackedMove move, UndoRecord &undo) {
+	int nb_cards = movedCards(state_, move);
+	if (nb_cards == 0)
+		return false;
+
+	undo.move = move;
+	undo.nb_moved_cards = nb_cards;
+	undo.nb_safe_moves = 0;
+	undo.hash = hash_;
+	undo.reversible_move = reversible_move_;
+	undo.reversible_nb_cards = reversible_nb_cards_;
+
+	moveRun_(move.from(), move.to(), nb_cards);
 
-		move(const_cast<CardStorage *>(from), const_cast<CardStorage *>(to));
+	std::optional<std::pair<int, int>> safe_move;
+	while ((safe_move = findSafeHomeMove(state_)).has_value()) {
+		move_(safe_move->first, safe_move->second);
+		undo.safe_moves[undo.nb_safe_moves++] = PackedMove(safe_move->first, safe_move->second);
 	}
+	reversible_move_ = undo.nb_safe_moves > 0 ? std::nullopt : std::optional<PackedMove>(move);
+	reversible_nb_cards_ = nb_cards;
+
+    SearchState::nb_expanded++;
+
+	return true;
+}
+
+void SearchState::undo(const UndoRecord &undo) {
+	// every move is reverted by moving the card straight back, legality does not matter
+	for (int i = undo.nb_safe_moves - 1; i >= 0; --i)
+		slotMove(state_, undo.safe_moves[i].to(), undo.safe_moves[i].from());
+	slotMoveRun(state_, undo.move.to(), undo.move.from(), undo.nb_moved_cards);
+
+	hash_ = undo.hash;
+	reversible_move_ = undo.reversible_move;
+	reversible_nb_cards_ = undo.reversible_nb_cards;
+}
+
+// expects a legal move
+void SearchState::move_(int from_slot, int to_slot) {
+	hash_ ^= zobristMoveDelta(state_, from_slot, to_slot);
+	slotMove(state_, from_slot, to_slot);
+}
+
+// expects a legal move
+void SearchState::moveRun_(int from_slot, int to_slot, int nb_cards) {
+	if (nb_cards == 1) {
+		move_(from_slot, to_slot);
+		return;
+	}
+
+	hash_ ^= zobristRunDelta(state_, from_slot, to_slot, nb_cards);
+	slotMoveRun(state_, from_slot, to_slot, nb_cards);
+}
+
+bool SearchState::runSafeMoves_() {
+	bool made_any = false;
+	std::optional<std::pair<int, int>> safe_move;
+	while ((safe_move = findSafeHomeMove(state_)).has_value()) {
+		move_(safe_move->first, safe_move->second);
+		made_any = true;
+	}
+
+	return made_any;
 }
 
 bool SearchState::isFinal() const {
@@ -56,34 +148,51 @@ bool SearchState::isFinal() const {
 	return true;
 }
 
-unsigned long long SearchState::nb_expanded = 0;
+bool SearchState::isDeadEnd() const {
+	if (options_.dead_end_depth < 0)
+		return false;
+
+	bool dead_end = ::isDeadEnd(state_, options_.dead_end_depth);
+	if (dead_end)
+		SearchState::nb_dead_ends++;
+
+	return dead_end;
+}
+
+thread_local unsigned long long SearchState::nb_expanded = 0;
+std::atomic<unsigned long long> SearchState::nb_expanded_flushed{0};
+thread_local unsigned long long SearchState::nb_pruned = 0;
+std::atomic<unsigned long long> SearchState::nb_pruned_flushed{0};
+thread_local unsigned long long SearchState::nb_dead_ends = 0;
+std::atomic<unsigned long long> SearchState::nb_dead_ends_flushed{0};
+thread_local unsigned long long SearchState::nb_evaluated = 0;
+std::atomic<unsigned long long> SearchState::nb_evaluated_flushed{0};
 
 std::vector<SearchAction> SearchState::actions() const {
-	auto raw_moves = availableMoves(
-		state_.non_homes.begin(),
-		state_.non_homes.end(),
-		state_.all_storage.begin(),
-		state_.all_storage.end()
-	);	
+	MoveBuffer buffer;
+	actions(buffer);
 
 	std::vector<SearchAction> moves;
-	std::transform(
-		raw_moves.begin(),
-		raw_moves.end(),
-		std::back_inserter(moves),
-		[&](RawMove raw_move){
-			return SearchAction{locFromPtr(state_, raw_move.first), locFromPtr(state_, raw_move.second)};
-		}
-	);
+	for (auto move : buffer)
+		moves.push_back(SearchAction{move});
+
 	return moves;
 }
 
+void SearchState::actions(MoveBuffer &moves) const {
+	collectLegalMoves(state_, moves, options_);
+	if (options_.prune)
+		SearchState::nb_pruned += pruneRedundantMoves(state_, moves, reversible_move_);
+	if (options_.por && reversible_move_.has_value() && reversible_nb_cards_ == 1)
+		SearchState::nb_pruned += pruneCommutedMoves(state_, moves, *reversible_move_);
+}
+
 std::ostream& operator<< (std::ostream& os, const SearchState & state) {
 	os << state.state_;
 	return os;
 }
 
 std::ostream& operator<< (std::ostream& os, const SearchAction & action) {
-	os << action.from_ << " " << action.to_;
+	os << action.from() << " " << action.to();
 	return os;
 }
@@ -3,7 +3,12 @@
 
 #include "move.h"
 #include "game.h"
+#include "move-engine.h"
+#include "packed-state.h"
+#include "flat-state-set.h"
 
+#include <atomic>
+#include <optional>
 #include <ostream>
 
 class SearchState;
@@ -12,33 +17,91 @@ class AStarHeuristicItf;
 
 class SearchAction {
 public:
-	SearchAction(Location from, Location to) : from_(from), to_(to) {} ;
+	SearchAction(Location from, Location to) : move_(slotFromLoc(from), slotFromLoc(to)) {} ;
+	explicit SearchAction(PackedMove move) : move_(move) {} ;
 	SearchState execute(const SearchState& state) const ;
 
+	Location from() const {return locFromSlot(move_.from());}
+	Location to() const {return locFromSlot(move_.to());}
+	PackedMove packed() const {return move_;}
+
     friend std::ostream& operator<< (std::ostream& os, const SearchAction & action) ;
 private:
-	Location from_;
-	Location to_;
+	PackedMove move_;
+};
+
+// Everything needed to revert SearchState::apply(), the primary move and the safe moves
+// to home it triggered, in the order they were made
+struct UndoRecord {
+    PackedMove move;
+    std::uint8_t nb_moved_cards;
+    std::uint8_t nb_safe_moves;
+    std::array<PackedMove, nb_cards> safe_moves;
+    std::uint64_t hash;
+    std::optional<PackedMove> reversible_move;
+    std::uint8_t reversible_nb_cards;
 };
 
 class SearchState {
 public:
-    explicit SearchState(GameState state) : state_(state) {}
+    explicit SearchState(GameState state, MoveOptions options = {}) :
+        state_(state), hash_(zobristHash(state_)), options_(options) {}
 
 	bool isFinal() const;
+	// The position provably can not be solved, solvers drop such states before queueing them.
+	// Always false unless enabled by the options.
+	bool isDeadEnd() const;
+	// Zobrist hash of the underlying GameState, maintained incrementally by execute()
+	std::uint64_t hash() const {return hash_;}
+	// Compact key of the canonical form, for closed lists
+	PackedState packed() const {return packState(state_);}
+	const MoveOptions &options() const {return options_;}
+	// Same position under other options, without the move which led here
+	SearchState withOptions(const MoveOptions &options) const {return SearchState(state_, options);}
 	std::vector<SearchAction> actions() const;
+	// Same actions, written into a reusable buffer without allocating
+	void actions(MoveBuffer &moves) const;
 
 	bool execute(Location from, Location to);
+	bool execute(PackedMove move);
+	// In-place variant of execute(), records what is needed to revert the move in undo
+	bool apply(PackedMove move, UndoRecord &undo);
+	// Reverts the last apply() exactly, records have to be undone in the reverse order
+	void undo(const UndoRecord &undo);
+    // expansions counted by the calling thread and those flushed by finished worker threads
     static unsigned long long nbExpanded();
+    // moves left out by the pruning, counted the same way
+    static unsigned long long nbPruned();
+    // states recognized by isDeadEnd(), counted the same way
+    static unsigned long long nbDeadEnds();
+    // calls of compute_heuristic(), counted the same way
+    static unsigned long long nbEvaluated();
+    // hands the counts of the calling thread over to the global ones
+    static void flushCounters();
 
     friend std::ostream& operator<< (std::ostream& os, const SearchState & state) ;
     friend bool operator<(const SearchState &a, const SearchState &b) ;
     friend bool operator==(const SearchState &a, const SearchState &b) ;
     friend double compute_heuristic(const SearchState &state, const AStarHeuristicItf &heuristic);
 private:
-	void runSafeMoves_();
+	// returns whether any move was made
+	bool runSafeMoves_();
+	void move_(int from_slot, int to_slot);
+	void moveRun_(int from_slot, int to_slot, int nb_cards);
 	GameState state_;
-    static unsigned long long nb_expanded;
+	std::uint64_t hash_;
+	MoveOptions options_;
+	// the move which led here, unless it triggered safe moves to home and can not be simply reverted
+	std::optional<PackedMove> reversible_move_;
+	std::uint8_t reversible_nb_cards_ = 0;
+    static thread_local unsigned long long nb_expanded;
+    static std::atomic<unsigned long long> nb_expanded_flushed;
+    static thread_local unsigned long long nb_pruned;
+    static std::atomic<unsigned long long> nb_pruned_flushed;
+    static thread_local unsigned long long nb_dead_ends;
+    static std::atomic<unsigned long long> nb_dead_ends_flushed;
+    static thread_local unsigned long long nb_evaluated;
+    static std::atomic<unsigned long long> nb_evaluated_flushed;
 };
 
 
@@ -46,6 +109,19 @@ class SearchStrategyItf {
 public:
 	virtual std::vector<SearchAction> solve(const SearchState &init_state) =0 ;
 	virtual ~SearchStrategyItf() {}
+
+	// Occupancy of the closed list of the last solve(), empty for solvers without one
+	const ClosedListStats &closedListStats() const {return closed_stats_;}
+
+protected:
+	ClosedListStats closed_stats_;
+};
+
+namespace std {
+template <>
+struct hash<SearchState> {
+    size_t operator()(const SearchState &state) const {return state.hash();}
 };
+}
 
 #endif
@@ -3,8 +3,11 @@
 
 #include "search-interface.h"
 #include "game.h"
+#include "open-list.h"
 
+#include <chrono>
 #include <memory>
+#include <string>
 #include <vector>
 
 class DummySearch : public SearchStrategyItf {
@@ -28,6 +31,22 @@ private:
     size_t mem_limit_;
 };
 
+// Breadth-first search keeping its layers on disk. Every layer is a sorted file of packed
+// states; children are gathered in a bounded buffer which is written out as sorted runs,
+// the runs are then merged, and duplicates of the two previous layers dropped on the way.
+// The solution is recovered by scanning the layers backwards for the parents.
+class ExternalBreadthFirstSearch : public SearchStrategyItf {
+public:
+    // the layer files are kept in a fresh directory under work_dir
+    ExternalBreadthFirstSearch(size_t mem_limit, std::string work_dir) :
+        mem_limit_(mem_limit), work_dir_(std::move(work_dir)) {}
+	std::vector<SearchAction> solve(const SearchState &init_state) override ;
+
+private:
+    size_t mem_limit_;
+    std::string work_dir_;
+};
+
 class DepthFirstSearch : public SearchStrategyItf {
 public:
     DepthFirstSearch(int depth_limit, size_t mem_limit) :
@@ -39,23 +58,182 @@ private:
 };
 
 
+// Depth-limited DFS over several threads. Each worker goes depth first on its own deque,
+// idle workers steal the shallowest waiting states, i.e. the largest subtrees, from the
+// others. Duplicates are detected through one shared closed list.
+class ParallelDepthFirstSearch : public SearchStrategyItf {
+public:
+    // nb_threads of 0 takes all hardware threads
+    ParallelDepthFirstSearch(int depth_limit, size_t mem_limit, size_t nb_threads);
+	std::vector<SearchAction> solve(const SearchState &init_state) override ;
+private:
+    int depth_limit_;
+    size_t mem_limit_;
+    size_t nb_threads_;
+};
+
+
 class AStarHeuristicItf {
 public:
     virtual double distanceLowerBound(const GameState &state) const =0;
+    virtual ~AStarHeuristicItf() {}
 };
 
 
+// With lazy_heuristic, children are queued with the heuristic value of their parent
+// and evaluated only when popped, going back to the open list if their f value grows.
 class AStarSearch : public SearchStrategyItf {
 public:
-    AStarSearch(std::unique_ptr<AStarHeuristicItf> &&heuristic, size_t mem_limit) : 
+    AStarSearch(std::unique_ptr<AStarHeuristicItf> &&heuristic, size_t mem_limit, TieBreak tie_break = TieBreak::LowH, bool lazy_heuristic = false) : 
         heuristic_(std::move(heuristic)),
-        mem_limit_(mem_limit)
+        mem_limit_(mem_limit),
+        tie_break_(tie_break),
+        lazy_heuristic_(lazy_heuristic)
         {}
 	std::vector<SearchAction> solve(const SearchState &init_state) override ;
 
 private:
     const std::unique_ptr<AStarHeuristicItf> heuristic_;
     size_t mem_limit_;
+    TieBreak tie_break_;
+    bool lazy_heuristic_;
+};
+
+// Iterative deepening A*, memory taken is given by the transposition table only.
+// The table remembers the visits of the running iteration, so that transpositions
+// reached again with no smaller depth are skipped, and the backed-up heuristic values,
+// which sharpen the heuristic in the next iterations. Values are only backed up from
+// subtrees without skipped transpositions, as these would leave out some f values.
+class IDAStarSearch : public SearchStrategyItf {
+public:
+    // tt_size is the number of table entries, rounded down to a power of two
+    IDAStarSearch(std::unique_ptr<AStarHeuristicItf> &&heuristic, size_t tt_size);
+	std::vector<SearchAction> solve(const SearchState &init_state) override ;
+
+private:
+    struct TableEntry_ {
+        std::uint64_t hash;
+        double h;
+        std::uint32_t g;
+        std::uint32_t iteration;
+    };
+
+    double search_(SearchState &state, int g, double bound);
+    TableEntry_ &entryFor_(std::uint64_t hash) {return table_[hash & (table_.size() - 1)];}
+
+    const std::unique_ptr<AStarHeuristicItf> heuristic_;
+    std::vector<TableEntry_> table_;
+    std::uint32_t iteration_;
+    // visits skipped as transpositions so far
+    unsigned long long nb_transpositions_;
+    std::vector<PackedMove> path_;
+    bool found_;
+};
+
+// Hash distributed A*. Every worker thread owns the states whose hash falls into its
+// partition and keeps their open and closed lists. Generated children are sent in batches
+// to their owners through lock-free inboxes. A state reached again with a lower g is opened
+// again. Once a solution is known, states whose f value can not beat it are dropped, the search
+// ends when no state is left anywhere. The solution is thus the shortest one for admissible
+// heuristics only; with the bundled ones, which are not admissible, its length may change
+// with the number of threads. With first_solution, the search ends with the first solution
+// found instead, like AStarSearch.
+class HDAStarSearch : public SearchStrategyItf {
+public:
+    // nb_threads of 0 takes all hardware threads
+    HDAStarSearch(
+        std::unique_ptr<AStarHeuristicItf> &&heuristic,
+        size_t mem_limit,
+        size_t nb_threads,
+        TieBreak tie_break = TieBreak::LowH,
+        bool first_solution = false
+    );
+	std::vector<SearchAction> solve(const SearchState &init_state) override ;
+
+private:
+    const std::unique_ptr<AStarHeuristicItf> heuristic_;
+    size_t mem_limit_;
+    size_t nb_threads_;
+    TieBreak tie_break_;
+    bool first_solution_;
+};
+
+// Breadth-first search keeping only the beam_width best states of every layer according
+// to the heuristic. States met in any earlier layer are not taken again, so the memory
+// stays within O(beam_width * depth). Not complete, it can drop the only way to the goal.
+class BeamSearch : public SearchStrategyItf {
+public:
+    BeamSearch(std::unique_ptr<AStarHeuristicItf> &&heuristic, size_t beam_width) :
+        heuristic_(std::move(heuristic)),
+        beam_width_(beam_width)
+        {}
+	std::vector<SearchAction> solve(const SearchState &init_state) override ;
+
+private:
+    const std::unique_ptr<AStarHeuristicItf> heuristic_;
+    size_t beam_width_;
+};
+
+// Anytime A*: runs weighted A* (f = g + weight * h) with a large weight first, to get
+// some solution quickly, then restarts with smaller and smaller weights down to 1,
+// looking for shorter solutions only. Once the time or memory budget runs out,
+// the best solution found so far is returned.
+class AnytimeAStarSearch : public SearchStrategyItf {
+public:
+    // time_limit of zero means no limit
+    AnytimeAStarSearch(
+        std::unique_ptr<AStarHeuristicItf> &&heuristic,
+        size_t mem_limit,
+        std::chrono::milliseconds time_limit,
+        double initial_weight
+    );
+	std::vector<SearchAction> solve(const SearchState &init_state) override ;
+
+private:
+    struct RunResult_ {
+        std::vector<SearchAction> solution;
+        bool out_of_budget;
+        ClosedListStats closed_stats;
+    };
+
+    RunResult_ weightedRun_(
+        const SearchState &init_state,
+        double weight,
+        size_t max_length,
+        std::chrono::steady_clock::time_point deadline
+    ) const;
+
+    const std::unique_ptr<AStarHeuristicItf> heuristic_;
+    size_t mem_limit_;
+    std::chrono::milliseconds time_limit_;
+    double initial_weight_;
+};
+
+// Many independent random walks spread over threads. Walk i draws its moves from its own
+// generator seeded by (seed, i) and the successful walk with the lowest index wins, so the
+// solution only depends on the seed. Walks with higher indices stop once a walk succeeds.
+// Moves are picked with weights exp(-bias * (h - min h)) over the children, or uniformly
+// with a bias of 0, which needs no heuristic.
+class RolloutSearch : public SearchStrategyItf {
+public:
+    // nb_threads of 0 takes all hardware threads
+    RolloutSearch(
+        std::unique_ptr<AStarHeuristicItf> &&heuristic,
+        size_t nb_rollouts,
+        size_t max_depth,
+        std::uint64_t seed,
+        double bias,
+        size_t nb_threads
+    );
+	std::vector<SearchAction> solve(const SearchState &init_state) override ;
+
+private:
+    const std::unique_ptr<AStarHeuristicItf> heuristic_;
+    size_t nb_rollouts_;
+    size_t max_depth_;
+    std::uint64_t seed_;
+    double bias_;
+    size_t nb_threads_;
 };
 
 // beware, this has been proven to NOT be a valid heuristic!
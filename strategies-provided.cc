@@ -5,6 +5,7 @@
 #include <algorithm>
 
 double compute_heuristic(const SearchState &state, const AStarHeuristicItf &heuristic) {
+    SearchState::nb_evaluated++;
     return heuristic.distanceLowerBound(state.state_);
 }
 
@@ -47,7 +48,7 @@ double OufOfHome_Pseudo::distanceLowerBound(const GameState &state) const {
     for (const auto &home : state.homes) {
         auto opt_top = home.topCard();
         if (opt_top.has_value())
-            cards_out_of_home -= opt_top->value;
+            cards_out_of_home -= opt_top->value();
     }
 
     return cards_out_of_home;
@@ -1,67 +1,73 @@
 #include "search-strategies.h"
+#include "flat-state-set.h"
+#include "node-arena.h"
 #include <queue>
 #include <stack>
-#include <set>
 #include "memusage.h"
 #include <optional>
 #include <climits>
 #include <iostream>
 #include <vector>
 
-// Structure for BFS and DFS
-typedef struct
+// Closed lists start at 1/1024 of their memory budget, which saves the early rehashes
+// without zero-filling the whole budget for searches that end after a few states
+constexpr size_t closed_reserve_fraction = 1024;
+
+// Hands the statistics of a closed list to the solver once the search returns
+class ClosedListRecord
 {
-	std::shared_ptr<SearchState> parent; // Pointer to parent SearchState
-	SearchAction parent_act;			 // Action which is used on parent SearchState to get current State
-	int depth;							 // Used to track depth in Tree (only in DFS)
-} Node;
-
-// Structures used for priority queue in A star algorithm
-// and its assembly
-typedef struct
+public:
+	ClosedListRecord(const FlatStateSet &set, ClosedListStats &stats) : set_(set), stats_(stats) {}
+	~ClosedListRecord() { stats_ = set_.stats(); }
+
+private:
+	const FlatStateSet &set_;
+	ClosedListStats &stats_;
+};
+
+// Open list entry for BFS and DFS
+struct Node
 {
-	std::shared_ptr<SearchState> parent;
-	SearchAction parent_act;
-} Node_Assembly;
+	SearchState state; // State to be expanded
+	NodeId id;		   // Its node in the search tree
+	int depth;		   // Used to track depth in Tree (only in DFS)
+};
 
+// Open list entry for A star algorithm, its f value is kept by the open list
 struct Node_Queue
 {
-	double value;
 	int depth;
-	std::shared_ptr<SearchState> parent;
-	bool operator<(const Node_Queue &rhs) const
-	{
-		return value > rhs.value;
-	}
+	SearchState state;
+	NodeId id;
+	double h;		// Heuristic value, the one of the parent until evaluated
+	bool evaluated; // Only false in the lazy mode
 };
 
 std::vector<SearchAction> BreadthFirstSearch::solve(const SearchState &init_state)
 {
-	std::set<SearchState> closed;					   // Closed list for SearchStates
-	std::queue<std::shared_ptr<SearchState>> open;	   // Open Queue for Searchstates (not expanded nodes)
-	std::map<std::shared_ptr<SearchState>, Node> tree; // SearchState tree
+	FlatStateSet closed(mem_limit_ / 2); // Closed list of packed canonical SearchStates
+	std::queue<Node> open;				 // Open Queue for Searchstates (not expanded nodes)
+	NodeArena tree;						 // SearchState tree
+	closed.reserve(mem_limit_ / 2 / closed_reserve_fraction / sizeof(PackedState));
+	ClosedListRecord record(closed, closed_stats_);
 
 	if (init_state.isFinal())
 	{
 		return {};
 	}
 
-	bool reached_final = false;
-
-	std::shared_ptr<SearchState> parent_state = std::make_shared<SearchState>(init_state);
-
-	open.push(parent_state); // Pushing initial state to open list
+	open.push({init_state, tree.addRoot(), 0}); // Pushing initial state to open list
 
 	auto old_memory = getCurrentRSS();
+	MoveBuffer actions; // reused for every expansion
 
-	while (!open.empty() && !reached_final)
+	while (!open.empty())
 	{
 		/* Getting SearchState from top of Queue */
-		auto current_parent = open.front();
-		SearchState working_state(*current_parent);
+		Node current = open.front();
 		open.pop();
 
-		auto actions = working_state.actions();
+		current.state.actions(actions);
 		/* Tracking memory */
 		auto taken_memory = getCurrentRSS();
 		if ((taken_memory - old_memory) * 4 + taken_memory > mem_limit_)
@@ -71,117 +77,90 @@ std::vector<SearchAction> BreadthFirstSearch::solve(const SearchState &init_stat
 		}
 		old_memory = taken_memory;
 
-		for (auto act : actions)
+		for (auto move : actions)
 		{
-			auto new_state = act.execute(working_state);
-			if (closed.count(new_state) == 0)
-			{ // if state is in closed, dont do anything
-				closed.insert(new_state);
-				auto new_shared = std::make_shared<SearchState>(new_state);
-				open.push(new_shared);
+			auto new_state = SearchAction(move).execute(current.state);
+			if (closed.insert(new_state.packed()))
+			{ // if an equivalent state is in closed, dont do anything
+				if (new_state.isDeadEnd())
+				{
+					continue; // provably unsolvable, not worth queueing
+				}
+
 				// Generating new node to the tree
-				Node parent_node = {current_parent, act, 0};
-				tree.insert({new_shared, parent_node});
+				NodeId new_id = tree.add(current.id, move);
 
 				if (new_state.isFinal())
 				{
-					reached_final = true;
-					parent_state = new_shared;
-					break;
+					/* Backtracking the result from the final node */
+					return tree.pathTo(new_id);
 				}
-			}
-		}
-	}
 
-	if (reached_final)
-	{
-		/* Backtracking the result from the final node */
-		std::vector<SearchAction> solution;
-		while (true)
-		{
-			auto tree_find = tree.find(parent_state);
-			if (tree_find == tree.end())
+				open.push({new_state, new_id, 0});
+			}
+			else if (closed.full())
 			{
-				break;
+				return {}; // the closed list ran out of memory
 			}
-			auto node = tree_find->second;
-			solution.insert(solution.begin(), node.parent_act);
-			parent_state = node.parent;
 		}
-		return solution;
 	}
+
 	return {};
 }
 
 std::vector<SearchAction> DepthFirstSearch::solve(const SearchState &init_state)
 {
 
-	std::set<SearchState> closed;					   // Closed list for SearchStates
-	std::stack<std::shared_ptr<SearchState>> open;	   // Open Stack for Searchstates (not expanded nodes)
-	std::map<std::shared_ptr<SearchState>, Node> tree; // SearchState tree
+	FlatStateSet closed(mem_limit_ / 2); // Closed list of packed canonical SearchStates
+	std::stack<Node> open;				 // Open Stack for Searchstates (not expanded nodes)
+	NodeArena tree;						 // SearchState tree
+	closed.reserve(mem_limit_ / 2 / closed_reserve_fraction / sizeof(PackedState));
+	ClosedListRecord record(closed, closed_stats_);
 
 	if (init_state.isFinal())
 	{
 		return {};
 	}
 
-	bool reached_final = false;
-	std::shared_ptr<SearchState> parent_state = std::make_shared<SearchState>(init_state);
-	int current_depth = 0;
 	/** Inserting initial node **/
-	Node init_node = {parent_state, init_state.actions()[0], 0};
-	open.push(parent_state);
-	tree.insert({parent_state, init_node});
+	open.push({init_state, tree.addRoot(), 0});
+	MoveBuffer actions; // reused for every expansion
 
-	while (!open.empty() && !reached_final)
+	while (!open.empty())
 	{
 		/* Poping from the stack */
-		auto current_parent = open.top();
-		SearchState working_state(*current_parent);
-		current_depth = tree.find(current_parent)->second.depth; // getting the depth of parent node
+		Node current = open.top();
 		open.pop();
-		if (current_depth >= depth_limit_)
+		if (current.depth >= depth_limit_)
 		{
 			continue; // skipping the node expansion
 		}
 
-		auto actions = working_state.actions();
-		for (auto act : actions)
+		current.state.actions(actions);
+		for (auto move : actions)
 		{
-			auto new_state = act.execute(working_state);
-			if (closed.count(new_state) == 0)
+			auto new_state = SearchAction(move).execute(current.state);
+			if (closed.insert(new_state.packed()))
 			{
-				closed.insert(new_state);
-				auto new_shared = std::make_shared<SearchState>(new_state);
-				open.push(new_shared);
-				Node parent_node = {current_parent, act, current_depth + 1}; // incrementing depth
-				tree.insert({new_shared, parent_node});
+				if (new_state.isDeadEnd())
+				{
+					continue; // provably unsolvable, not worth queueing
+				}
+
+				NodeId new_id = tree.add(current.id, move);
 				if (new_state.isFinal())
 				{
-					reached_final = true;
-					parent_state = new_shared;
-					break;
+					/* Backtracking the result */
+					return tree.pathTo(new_id);
 				}
-			}
-		}
-	}
 
-	if (reached_final)
-	{
-		/* Backtracking the result */
-		std::vector<SearchAction> solution;
-		while (true)
-		{
-			auto tree_find = tree.find(parent_state);
-			if (tree_find->second.depth == 0)
+				open.push({new_state, new_id, current.depth + 1}); // incrementing depth
+			}
+			else if (closed.full())
 			{
-				break;
+				return {}; // the closed list ran out of memory
 			}
-			auto node = tree_find->second;
-			solution.insert(solution.begin(), node.parent_act);
-			parent_state = node.parent;
 		}
-		return solution;
 	}
 
 	return {};
@@ -220,7 +199,7 @@ double StudentHeuristic::distanceLowerBound(const GameState &state) const
 	{
 		auto opt_top = home.topCard();
 		if (opt_top.has_value())
-			cards_out_of_home -= opt_top->value;
+			cards_out_of_home -= opt_top->value();
 	}
 
 	int number_of_cards_to_free = all_cards_n;
@@ -238,7 +217,7 @@ double StudentHeuristic::distanceLowerBound(const GameState &state) const
 			int count = 0;
 			for (int i = stack.storage().size(); 0 < i; i--)
 			{
-				auto new_card = stack.storage()[i];
+				auto new_card = stack.storage()[i - 1];
 				if (home.canAccept(new_card) || count >= best_move)
 				{
 					best_move = count;
@@ -272,92 +251,89 @@ double StudentHeuristic::distanceLowerBound(const GameState &state) const
 
 std::vector<SearchAction> AStarSearch::solve(const SearchState &init_state)
 {
+	closed_stats_ = {};
 	if (init_state.isFinal())
 		return {};
 
-	std::set<SearchState> closed;
-	std::priority_queue<Node_Queue> open;
-	std::map<std::shared_ptr<SearchState>, Node_Assembly> tree;
+	FlatStateSet closed(mem_limit_ / 2);
+	BucketOpenList<Node_Queue> open(tie_break_);
+	NodeArena tree;
+	closed.reserve(mem_limit_ / 2 / closed_reserve_fraction / sizeof(PackedState));
+	ClosedListRecord record(closed, closed_stats_);
 
-	bool reached_final = false;
 	double initial_value = 0;
-	int current_depth = 0;
 
 	// Initialized variables and push them into specified lists
-	std::shared_ptr<SearchState> parent_state = std::make_shared<SearchState>(init_state);
-	Node_Assembly init_node = {parent_state, init_state.actions()[0]};
-	Node_Queue init_queue = {initial_value, current_depth, parent_state};
-	open.push(init_queue);
-	tree.insert({parent_state, init_node});
+	open.push(initial_value, 0, {0, init_state, tree.addRoot(), 0, true});
 
 	auto old_memory = getCurrentRSS();
+	MoveBuffer actions; // reused for every expansion
 
-	while (!open.empty() && !reached_final)
+	while (!open.empty())
 	{
-		std::shared_ptr<SearchState> current_parent = open.top().parent;
-		current_depth = open.top().depth;
+		Node_Queue current = open.pop();
 
-		open.pop();
-		SearchState working_state(*current_parent);
+		if (!current.evaluated)
+		{
+			// Lazy mode, the node goes back if the exact heuristic raises its f value
+			double pushed_f = current.depth - 1 + current.h;
+			current.h = compute_heuristic(current.state, *heuristic_);
+			current.evaluated = true;
 
-		std::vector<SearchAction> actions = working_state.actions();
+			double f = current.depth - 1 + current.h;
+			if (f > pushed_f)
+			{
+				open.push(f, current.depth, current);
+				continue;
+			}
+		}
+
+		current.state.actions(actions);
 
 		/* Tracking memory */
 		auto taken_memory = getCurrentRSS();
 		if ((taken_memory - old_memory) * 5 + taken_memory > mem_limit_)
 		{
 			//  Taken memory + 4 * difference between last round and current round
-			// std::cout << "1";
-			// std::cout.flush();
 			return {};
 		}
 		old_memory = taken_memory;
 
-		for (auto act : actions)
+		for (auto move : actions)
 		{
-			SearchState new_state = act.execute(working_state);
+			SearchState new_state = SearchAction(move).execute(current.state);
 
-			if (closed.count(new_state) == 0)
+			if (closed.insert(new_state.packed()))
 			{
-				closed.insert(new_state);
-
-				// Use heuristics to compute new h, which will sort the values in the priority queue
-				std::shared_ptr<SearchState> new_shared = std::make_shared<SearchState>(new_state);
-				double h = current_depth + compute_heuristic(new_state, *heuristic_);
-				open.push({h, current_depth + 1, new_shared});
+				if (new_state.isDeadEnd())
+				{
+					continue; // provably unsolvable, not worth queueing
+				}
 
-				Node_Assembly parent_node = {current_parent, act};
-				tree.insert({new_shared, parent_node});
+				NodeId new_id = tree.add(current.id, move);
 				if (new_state.isFinal())
 				{
-					reached_final = true;
-					parent_state = new_shared;
-					break;
+					/* Backtracking the result from the final node */
+					return tree.pathTo(new_id);
 				}
-			}
-		}
-	}
 
-	if (reached_final)
-	{
-		/* Backtracking the result from the final node */
-		std::vector<SearchAction> solution;
-		while (true)
-		{
-			auto tree_find = tree.find(parent_state);
-			if (tree_find->second.parent == parent_state)
+				if (lazy_heuristic_)
+				{
+					// Evaluated once popped, until then the parent's value stands in
+					open.push(current.depth + current.h, current.depth + 1, {current.depth + 1, new_state, new_id, current.h, false});
+					continue;
+				}
+
+				// Use heuristics to compute new h, which will sort the values in the priority queue
+				double h = compute_heuristic(new_state, *heuristic_);
+				open.push(current.depth + h, current.depth + 1, {current.depth + 1, new_state, new_id, h, true});
+			}
+			else if (closed.full())
 			{
-				break;
+				return {}; // the closed list ran out of memory
 			}
-			auto node = tree_find->second;
-			solution.insert(solution.begin(), node.parent_act);
-			parent_state = node.parent;
 		}
-		// std::cout << "0";
-		// std::cout.flush();
-		return solution;
 	}
-	// std::cout << "1";
-	// std::cout.flush();
+
 	return {};
 }
@@ -4,8 +4,20 @@
 #include "card-storage.h"
 #include "move.h"
 #include "game.h"
-
+#include "packed-state.h"
+#include "move-engine.h"
+#include "search-interface.h"
+#include "flat-state-set.h"
+#include "node-arena.h"
+#include "open-list.h"
+#include "dead-ends.h"
+#include "pattern-database.h"
+#include "search-strategies.h"
+
+#include <cstdio>
+#include <filesystem>
 #include <sstream>
+#include <thread>
 
 std::string cardRepresentation(const Card &card) {
 	std::stringstream ss;
@@ -50,9 +62,9 @@ TEST_CASE("Card construction and printing tests") {
 	REQUIRE(cardRepresentation({Color::Club, 7}) == "7c");
 	REQUIRE(cardRepresentation({Color::Spade, 7}) == "7s");
 
-	REQUIRE(render_color_map.at(Card{Color::Spade, 7}.color) == render_color_map.at(Card{Color::Club, 7}.color));
-	REQUIRE(render_color_map.at(Card{Color::Spade, 7}.color) != render_color_map.at(Card{Color::Heart, 7}.color));
-	REQUIRE(render_color_map.at(Card{Color::Diamond, 7}.color) == render_color_map.at(Card{Color::Heart, 7}.color));
+	REQUIRE(render_color_map.at(Card{Color::Spade, 7}.color()) == render_color_map.at(Card{Color::Club, 7}.color()));
+	REQUIRE(render_color_map.at(Card{Color::Spade, 7}.color()) != render_color_map.at(Card{Color::Heart, 7}.color()));
+	REQUIRE(render_color_map.at(Card{Color::Diamond, 7}.color()) == render_color_map.at(Card{Color::Heart, 7}.color()));
 }
 
 TEST_CASE("Card comparison tests") {
@@ -71,6 +83,28 @@ TEST_CASE("Card comparison tests") {
 	REQUIRE_FALSE(Card{Color::Heart, 2} < Card{Color::Heart, 1});
 }
 
+TEST_CASE("Packed card representation") {
+	REQUIRE(sizeof(Card) == 1);
+
+	REQUIRE(Card{Color::Club, 12}.color() == Color::Club);
+	REQUIRE(Card{Color::Club, 12}.value() == 12);
+	REQUIRE(Card{Color::Heart, 3}.renderColor() == RenderColor::Red);
+	REQUIRE(Card{Color::Diamond, 3}.renderColor() == RenderColor::Red);
+	REQUIRE(Card{Color::Club, 3}.renderColor() == RenderColor::Black);
+	REQUIRE(Card{Color::Spade, 3}.renderColor() == RenderColor::Black);
+
+	for (int i = 0; i < nb_cards; ++i)
+		REQUIRE(Card::fromIndex(i).index() == i);
+	REQUIRE(Card{Color::Heart, 1}.index() == 0);
+	REQUIRE(Card{Color::Spade, king_value}.index() == nb_cards - 1);
+
+	REQUIRE(WorkStack::canSitOn({Color::Spade, 8}, {Color::Heart, 7}));
+	REQUIRE_FALSE(WorkStack::canSitOn({Color::Spade, 8}, {Color::Club, 7}));
+	REQUIRE_FALSE(WorkStack::canSitOn({Color::Spade, 8}, {Color::Heart, 6}));
+	REQUIRE(HomeDestination::canSitOn({Color::Spade, 8}, {Color::Spade, 9}));
+	REQUIRE_FALSE(HomeDestination::canSitOn({Color::Spade, 8}, {Color::Club, 9}));
+}
+
 TEST_CASE("FreeCell operations") {
     FreeCell free_cell;
 	REQUIRE(freeCellRepresentation(free_cell) == "_");
@@ -118,6 +152,12 @@ TEST_CASE("Home destiation operations") {
 
 	REQUIRE(home_heart.acceptCard({Color::Heart, 3}));
 	REQUIRE(homeRepresentation(home_heart) == "3h");
+
+	REQUIRE(cardRepresentation(*home_heart.getCard()) == "3h");
+	REQUIRE(cardRepresentation(*home_heart.getCard()) == "2h");
+	REQUIRE(cardRepresentation(*home_heart.getCard()) == "1h");
+	REQUIRE(homeRepresentation(home_heart) == "_");
+	REQUIRE_FALSE(home_heart.getCard().has_value());
 }
 
 TEST_CASE("Work stack operations") {
@@ -459,3 +499,677 @@ TEST_CASE("Ptr -> location conversion") {
     REQUIRE(locFromPtr(gs, &gs.free_cells[3]) == Location{LocationClass::FreeCells, 3});
 }
 
+
+TEST_CASE("Zobrist hash follows moves incrementally") {
+    EasyProducer producer(42, 40);
+    GameState gs = producer.produce();
+    std::default_random_engine rng(7);
+
+    std::uint64_t hash = zobristHash(gs);
+    for (int i = 0; i < 200; ++i) {
+        auto non_homes = gs.nonHomes();
+        auto all_storage = gs.allStorage();
+        auto moves = availableMoves(non_homes.begin(), non_homes.end(), all_storage.begin(), all_storage.end());
+        if (moves.empty())
+            break;
+
+        auto picked = moves[std::uniform_int_distribution<size_t>(0, moves.size()-1)(rng)];
+        hash ^= zobristMoveDelta(gs, slotFromLoc(locFromPtr(gs, picked.first)), slotFromLoc(locFromPtr(gs, picked.second)));
+        move(const_cast<CardStorage *>(picked.first), const_cast<CardStorage *>(picked.second));
+
+        REQUIRE(hash == zobristHash(gs));
+    }
+
+    GameState other = producer.produce();
+    REQUIRE(std::hash<GameState>{}(gs) != std::hash<GameState>{}(other));
+}
+
+TEST_CASE("Canonical form ignores order of stacks, free cells and homes") {
+    GameState a, b;
+
+    a.homes[0].acceptCard({Color::Club, 1});
+    a.homes[1].acceptCard({Color::Heart, 1});
+    a.free_cells[1].acceptCard({Color::Spade, 9});
+    a.free_cells[3].acceptCard({Color::Diamond, 4});
+    a.stacks[0].forceCard({Color::Heart, 7});
+    a.stacks[0].forceCard({Color::Spade, 6});
+    a.stacks[5].forceCard({Color::Club, 10});
+
+    b.homes[2].acceptCard({Color::Heart, 1});
+    b.homes[3].acceptCard({Color::Club, 1});
+    b.free_cells[0].acceptCard({Color::Diamond, 4});
+    b.free_cells[2].acceptCard({Color::Spade, 9});
+    b.stacks[7].forceCard({Color::Heart, 7});
+    b.stacks[7].forceCard({Color::Spade, 6});
+    b.stacks[1].forceCard({Color::Club, 10});
+
+    REQUIRE_FALSE(a == b);
+    REQUIRE(canonicalForm(a) == canonicalForm(b));
+    REQUIRE(canonicalForm(canonicalForm(a)) == canonicalForm(a));
+    REQUIRE(zobristHash(a) == zobristHash(b));
+    REQUIRE(zobristHash(canonicalForm(a)) == zobristHash(a));
+
+    b.stacks[1].forceCard({Color::Heart, 9});
+    REQUIRE_FALSE(canonicalForm(a) == canonicalForm(b));
+}
+
+TEST_CASE("Packed states identify canonical forms") {
+    EasyProducer producer(5, 30);
+    std::default_random_engine rng(11);
+
+    for (int deal = 0; deal < 5; ++deal) {
+        GameState gs = producer.produce();
+        for (int i = 0; i < 50; ++i) {
+            auto non_homes = gs.nonHomes();
+            auto all_storage = gs.allStorage();
+            auto moves = availableMoves(non_homes.begin(), non_homes.end(), all_storage.begin(), all_storage.end());
+            if (moves.empty())
+                break;
+
+            auto picked = moves[std::uniform_int_distribution<size_t>(0, moves.size()-1)(rng)];
+            move(const_cast<CardStorage *>(picked.first), const_cast<CardStorage *>(picked.second));
+
+            auto packed = packState(gs);
+            REQUIRE(unpackState(packed) == canonicalForm(gs));
+            REQUIRE(packState(canonicalForm(gs)) == packed);
+        }
+    }
+
+    GameState a, b;
+    a.stacks[0].forceCard({Color::Heart, 7});
+    a.free_cells[2].acceptCard({Color::Club, 3});
+    b.stacks[4].forceCard({Color::Heart, 7});
+    b.free_cells[0].acceptCard({Color::Club, 3});
+    REQUIRE(packState(a) == packState(b));
+    REQUIRE(std::hash<PackedState>{}(packState(a)) == std::hash<PackedState>{}(packState(b)));
+
+    b.stacks[4].forceCard({Color::Spade, 6});
+    REQUIRE(packState(a) != packState(b));
+    REQUIRE(((packState(a) < packState(b)) || (packState(b) < packState(a))));
+}
+
+TEST_CASE("Slot based move generation matches the storage based one") {
+    EasyProducer producer(3, 30);
+    std::default_random_engine rng(5);
+    GameState gs = producer.produce();
+
+    for (int i = 0; i < 100; ++i) {
+        auto non_homes = gs.nonHomes();
+        auto all_storage = gs.allStorage();
+        auto raw_moves = availableMoves(non_homes.begin(), non_homes.end(), all_storage.begin(), all_storage.end());
+
+        std::vector<RawMove> slot_moves;
+        forEachLegalMove(gs, [&](int from, int to){
+            REQUIRE(slotMoveLegal(gs, from, to));
+            slot_moves.push_back({ptrFromLoc(gs, locFromSlot(from)), ptrFromLoc(gs, locFromSlot(to))});
+        });
+        REQUIRE(slot_moves == raw_moves);
+
+        if (raw_moves.empty())
+            break;
+        auto picked = raw_moves[std::uniform_int_distribution<size_t>(0, raw_moves.size()-1)(rng)];
+        slotMove(gs, slotFromLoc(locFromPtr(gs, picked.first)), slotFromLoc(locFromPtr(gs, picked.second)));
+    }
+
+    for (int slot = 0; slot < nb_slots; ++slot)
+        REQUIRE(slotFromLoc(locFromSlot(slot)) == slot);
+}
+
+TEST_CASE("Packed moves and move buffers") {
+    for (int from = 0; from < first_home_slot; ++from) {
+        for (int to = 0; to < nb_slots; ++to) {
+            PackedMove move(from, to);
+            REQUIRE(move.from() == from);
+            REQUIRE(move.to() == to);
+            REQUIRE(move.code() < max_nb_moves);
+        }
+    }
+
+    EasyProducer producer(8, 30);
+    SearchState state(producer.produce());
+    MoveBuffer buffer;
+    for (int i = 0; i < 30; ++i) {
+        auto actions = state.actions();
+        state.actions(buffer);
+        REQUIRE(buffer.size() == actions.size());
+        for (size_t j = 0; j < actions.size(); ++j)
+            REQUIRE(buffer[j] == actions[j].packed());
+
+        if (buffer.empty())
+            break;
+        SearchAction act(buffer[i % buffer.size()]);
+        REQUIRE(SearchAction(act.from(), act.to()).packed() == act.packed());
+        state = act.execute(state);
+    }
+}
+
+TEST_CASE("Apply and undo revert moves exactly") {
+    EasyProducer producer(17, 25);
+    std::default_random_engine rng(3);
+
+    for (int deal = 0; deal < 5; ++deal) {
+        SearchState state(producer.produce());
+        SearchState initial(state);
+        std::vector<UndoRecord> undos;
+        std::vector<SearchState> visited{state};
+        MoveBuffer moves;
+
+        for (int i = 0; i < 40; ++i) {
+            state.actions(moves);
+            if (moves.empty())
+                break;
+
+            auto move = moves[std::uniform_int_distribution<size_t>(0, moves.size()-1)(rng)];
+            SearchState expected = SearchAction(move).execute(state);
+
+            undos.emplace_back();
+            REQUIRE(state.apply(move, undos.back()));
+            REQUIRE(state == expected);
+            REQUIRE(state.hash() == expected.hash());
+            visited.push_back(state);
+        }
+
+        while (!undos.empty()) {
+            visited.pop_back();
+            state.undo(undos.back());
+            undos.pop_back();
+            REQUIRE(state == visited.back());
+            REQUIRE(state.hash() == visited.back().hash());
+        }
+        REQUIRE(state == initial);
+    }
+}
+
+TEST_CASE("Flat state set") {
+    auto key = [](std::uint64_t i) {
+        PackedState packed{};
+        packed.words[0] = i + 1;
+        packed.words[3] = i * 7919;
+        return packed;
+    };
+
+    SECTION("Behaves as a set while growing") {
+        FlatStateSet set(std::numeric_limits<size_t>::max(), 16);
+        for (std::uint64_t i = 0; i < 5000; ++i) {
+            REQUIRE(set.insert(key(i)));
+            REQUIRE(!set.insert(key(i / 2)));
+        }
+
+        REQUIRE(set.size() == 5000);
+        REQUIRE(!set.full());
+        REQUIRE(set.loadFactor() <= 0.75);
+        REQUIRE(set.averageProbeLength() <= set.maxProbeLength());
+        for (std::uint64_t i = 0; i < 6000; ++i)
+            REQUIRE(set.contains(key(i)) == (i < 5000));
+
+        set.clear();
+        REQUIRE(set.size() == 0);
+        REQUIRE(!set.contains(key(0)));
+    }
+
+    SECTION("Refuses new keys beyond the memory budget") {
+        FlatStateSet set(16 * sizeof(PackedState), 1024);
+        REQUIRE(set.capacity() == 16);
+
+        std::uint64_t i = 0;
+        while (set.insert(key(i)))
+            ++i;
+
+        REQUIRE(set.full());
+        REQUIRE(set.size() == 15);
+        REQUIRE(set.bytes() <= 16 * sizeof(PackedState));
+        REQUIRE(!set.insert(key(0)));
+    }
+
+    SECTION("Keeps the lowest cost of every key") {
+        FlatStateCosts costs(std::numeric_limits<size_t>::max(), 16);
+        for (std::uint64_t i = 0; i < 5000; ++i)
+            REQUIRE(costs.lower(key(i), 10));
+
+        REQUIRE(costs.size() == 5000);
+        REQUIRE(!costs.lower(key(3), 10));
+        REQUIRE(!costs.lower(key(3), 11));
+        REQUIRE(costs.lower(key(3), 4));
+        REQUIRE(costs.cost(key(3)) == 4);
+        REQUIRE(costs.cost(key(4)) == 10);
+        REQUIRE(costs.cost(key(6000)) == std::numeric_limits<int>::max());
+        REQUIRE(costs.stats().nb_keys == 5000);
+    }
+
+    SECTION("Stores packed game states") {
+        EasyProducer producer(2, 30);
+        GameState gs = producer.produce();
+        SearchState state(gs);
+        FlatStateSet set;
+        set.reserve(100);
+        REQUIRE(set.capacity() >= 128);
+
+        REQUIRE(set.insert(state.packed()));
+        REQUIRE(!set.insert(packState(canonicalForm(gs))));
+        REQUIRE(set.contains(state.packed()));
+    }
+}
+
+TEST_CASE("Node arena reconstructs paths") {
+    NodeArena tree;
+    NodeId root = tree.addRoot();
+    NodeId a = tree.add(root, PackedMove(4, 0));
+    NodeId b = tree.add(a, PackedMove(5, 12));
+    NodeId c = tree.add(root, PackedMove(6, 1));
+
+    REQUIRE(tree.size() == 4);
+    REQUIRE(tree[b].parent == a);
+    REQUIRE(tree.pathTo(root).empty());
+    REQUIRE(tree.pathTo(c).size() == 1);
+
+    auto path = tree.pathTo(b);
+    REQUIRE(path.size() == 2);
+    REQUIRE(path[0].packed() == PackedMove(4, 0));
+    REQUIRE(path[1].packed() == PackedMove(5, 12));
+}
+
+TEST_CASE("Bucket open list") {
+    SECTION("Orders by f, then by the tie-break") {
+        BucketOpenList<int> low_h(TieBreak::LowH);
+        BucketOpenList<int> low_g(TieBreak::LowG);
+        std::vector<std::pair<int, int>> entries{{5, 2}, {3, 1}, {5, 4}, {7, 0}, {3, 3}, {4, 2}};
+        for (size_t i = 0; i < entries.size(); ++i) {
+            low_h.push(entries[i].first, entries[i].second, i);
+            low_g.push(entries[i].first, entries[i].second, i);
+        }
+
+        std::vector<int> h_order, g_order;
+        while (!low_h.empty())
+            h_order.push_back(low_h.pop());
+        while (!low_g.empty())
+            g_order.push_back(low_g.pop());
+
+        REQUIRE(h_order == std::vector<int>{4, 1, 5, 2, 0, 3});
+        REQUIRE(g_order == std::vector<int>{1, 4, 5, 0, 2, 3});
+        REQUIRE(!low_h.usesHeap());
+    }
+
+    SECTION("Falls back to a heap on non-integral values") {
+        BucketOpenList<int> open(TieBreak::LowH);
+        open.push(4, 1, 0);
+        open.push(2, 1, 1);
+        open.push(2.5, 1, 2);
+        open.push(2, 2, 3);
+        REQUIRE(open.usesHeap());
+        REQUIRE(open.size() == 4);
+
+        std::vector<int> order;
+        while (!open.empty())
+            order.push_back(open.pop());
+        REQUIRE(order == std::vector<int>{3, 1, 2, 0});
+    }
+
+    SECTION("Accepts lower f values after pops") {
+        BucketOpenList<int> open(TieBreak::LowG);
+        open.push(6, 0, 0);
+        open.push(8, 0, 1);
+        REQUIRE(open.pop() == 0);
+        open.push(2, 0, 2);
+        REQUIRE(open.pop() == 2);
+        REQUIRE(open.pop() == 1);
+        REQUIRE(open.empty());
+    }
+
+    SECTION("Accepts lower g values after pops") {
+        BucketOpenList<int> open(TieBreak::LowG);
+        open.push(5, 1, 0);
+        open.push(5, 3, 1);
+        REQUIRE(open.pop() == 0);
+        open.push(5, 0, 2);
+        open.push(5, 2, 3);
+        REQUIRE(open.pop() == 2);
+        REQUIRE(open.pop() == 3);
+        REQUIRE(open.pop() == 1);
+        open.push(5, 4, 4);
+        REQUIRE(open.pop() == 4);
+        REQUIRE(open.empty());
+    }
+}
+
+// 0 or 1 at random, never more than the distance, unlike the bundled heuristics
+struct CoinHeuristic : AStarHeuristicItf {
+    double distanceLowerBound(const GameState &gs) const override {
+        if (SearchState(gs).isFinal())
+            return 0;
+        return (zobristHash(gs) >> 7) & 1;
+    }
+};
+
+TEST_CASE("IDA* finds solutions as short as BFS") {
+    const size_t mem_limit = size_t{256} << 20;
+
+    EasyProducer producer(11, 20);
+    for (int i = 0; i < 10; ++i) {
+        SearchState init_state(producer.produce());
+        auto expected = BreadthFirstSearch(mem_limit).solve(init_state);
+        auto solution = IDAStarSearch(std::make_unique<CoinHeuristic>(), 1 << 16).solve(init_state);
+        REQUIRE(solution.size() == expected.size());
+
+        SearchState state(init_state);
+        for (const auto &action : solution)
+            state = action.execute(state);
+        REQUIRE(state.isFinal());
+    }
+}
+
+TEST_CASE("Sharded state set accepts every key once across threads") {
+    ShardedStateSet set;
+    std::atomic<int> nb_inserted{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&set, &nb_inserted](){
+            for (std::uint64_t i = 0; i < 2000; ++i) {
+                PackedState packed{};
+                packed.words[1] = i + 1;
+                if (set.insert(packed))
+                    ++nb_inserted;
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    REQUIRE(nb_inserted == 2000);
+    REQUIRE(set.size() == 2000);
+    REQUIRE(!set.full());
+}
+
+TEST_CASE("Supermoves") {
+    GameState gs;
+    gs.stacks[0].forceCard({Color::Spade, 13});
+    gs.stacks[0].forceCard({Color::Heart, 9});
+    gs.stacks[0].forceCard({Color::Club, 8});
+    gs.stacks[0].forceCard({Color::Diamond, 7});
+    gs.stacks[0].forceCard({Color::Spade, 6});
+    gs.stacks[1].forceCard({Color::Club, 10});
+    gs.stacks[2].forceCard({Color::Heart, 2});
+    for (int i = 3; i < nb_stacks; ++i)
+        gs.stacks[i].forceCard({Color::Club, i});
+    gs.free_cells[0].acceptCard({Color::Spade, 12});
+    gs.free_cells[1].acceptCard({Color::Diamond, 12});
+
+    REQUIRE(orderedRunLength(gs.stacks[0]) == 4);
+    REQUIRE(supermoveCapacity(gs, false) == 3);
+
+    SECTION("Run onto a non-empty stack is limited by the free cells") {
+        PackedMove move(first_stack_slot, first_stack_slot + 1);
+        REQUIRE(movedCards(gs, move) == 0);
+
+        gs.free_cells[1].getCard();
+        REQUIRE(supermoveCapacity(gs, false) == 4);
+        REQUIRE(movedCards(gs, move) == 4);
+    }
+
+    SECTION("Generated only when enabled, applied and undone with the hash") {
+        gs.free_cells[1].getCard();
+        gs.stacks[2].getCard();
+        REQUIRE(supermoveCapacity(gs, true) == 4);
+
+        SearchState plain(gs);
+        SearchState super(gs, MoveOptions{true});
+        MoveBuffer plain_moves, super_moves;
+        plain.actions(plain_moves);
+        super.actions(super_moves);
+
+        PackedMove onto_ten(first_stack_slot, first_stack_slot + 1);
+        PackedMove to_empty = PackedMove::runToEmpty(first_stack_slot, first_stack_slot + 2);
+        REQUIRE(to_empty.isRunToEmpty());
+        REQUIRE(to_empty.from() == first_stack_slot);
+        REQUIRE(to_empty.to() == first_stack_slot + 2);
+        REQUIRE(std::find(plain_moves.begin(), plain_moves.end(), onto_ten) == plain_moves.end());
+        REQUIRE(std::find(super_moves.begin(), super_moves.end(), onto_ten) != super_moves.end());
+        REQUIRE(std::find(super_moves.begin(), super_moves.end(), to_empty) != super_moves.end());
+        REQUIRE(movedCards(gs, to_empty) == 4);
+
+        for (auto move : {onto_ten, to_empty}) {
+            SearchState state(super);
+            UndoRecord undo;
+            REQUIRE(state.apply(move, undo));
+            REQUIRE(state.hash() == zobristHash(unpackState(state.packed())));
+            REQUIRE(state == SearchAction(move).execute(super));
+
+            state.undo(undo);
+            REQUIRE(state == super);
+            REQUIRE(state.hash() == super.hash());
+        }
+    }
+}
+
+TEST_CASE("Move pruning") {
+    GameState gs;
+    gs.stacks[0].forceCard({Color::Spade, 13});
+    gs.stacks[0].forceCard({Color::Spade, 6});
+    gs.stacks[1].forceCard({Color::Club, 6});
+    gs.stacks[1].forceCard({Color::Heart, 5});
+    gs.stacks[2].forceCard({Color::Diamond, 4});
+    for (int i = 5; i < nb_stacks; ++i)
+        gs.stacks[i].forceCard({Color::Club, 4 + i});
+    gs.free_cells[0].acceptCard({Color::Spade, 12});
+
+    SearchState plain(gs);
+    SearchState pruned(gs, MoveOptions{false, true});
+    MoveBuffer plain_moves, pruned_moves;
+    plain.actions(plain_moves);
+    unsigned long long nb_pruned_before = SearchState::nbPruned();
+    pruned.actions(pruned_moves);
+    REQUIRE(SearchState::nbPruned() - nb_pruned_before == plain_moves.size() - pruned_moves.size());
+
+    auto generated = [](const MoveBuffer &moves, int from, int to) {
+        return std::find(moves.begin(), moves.end(), PackedMove(from, to)) != moves.end();
+    };
+    for (auto move : pruned_moves)
+        REQUIRE(generated(plain_moves, move.from(), move.to()));
+
+    SECTION("Between free cells") {
+        REQUIRE(generated(plain_moves, 0, 1));
+        REQUIRE_FALSE(generated(pruned_moves, 0, 1));
+    }
+
+    SECTION("Only to the first of equal empty storages") {
+        REQUIRE(generated(pruned_moves, first_stack_slot, 1));
+        REQUIRE_FALSE(generated(pruned_moves, first_stack_slot, 2));
+        REQUIRE(generated(pruned_moves, first_stack_slot, first_stack_slot + 3));
+        REQUIRE_FALSE(generated(pruned_moves, first_stack_slot, first_stack_slot + 4));
+    }
+
+    SECTION("Whole stack onto an empty one") {
+        REQUIRE(generated(plain_moves, first_stack_slot + 2, first_stack_slot + 3));
+        REQUIRE_FALSE(generated(pruned_moves, first_stack_slot + 2, first_stack_slot + 3));
+    }
+
+    SECTION("Reverting the previous move") {
+        PackedMove move(first_stack_slot + 1, first_stack_slot);
+        REQUIRE(generated(pruned_moves, move.from(), move.to()));
+
+        SearchState child = SearchAction(move).execute(pruned);
+        MoveBuffer child_moves;
+        child.actions(child_moves);
+        MoveBuffer plain_child_moves;
+        SearchAction(move).execute(plain).actions(plain_child_moves);
+        REQUIRE(generated(plain_child_moves, first_stack_slot, first_stack_slot + 1));
+        REQUIRE_FALSE(generated(child_moves, first_stack_slot, first_stack_slot + 1));
+
+        UndoRecord undo;
+        SearchState applied(pruned);
+        REQUIRE(applied.apply(move, undo));
+        applied.actions(child_moves);
+        REQUIRE_FALSE(generated(child_moves, first_stack_slot, first_stack_slot + 1));
+
+        applied.undo(undo);
+        applied.actions(child_moves);
+        REQUIRE(child_moves.size() == pruned_moves.size());
+    }
+}
+
+TEST_CASE("Partial-order reduction") {
+    GameState gs;
+    gs.stacks[0].forceCard({Color::Spade, 13});
+    gs.stacks[0].forceCard({Color::Spade, 6});
+    gs.stacks[1].forceCard({Color::Club, 6});
+    gs.stacks[1].forceCard({Color::Heart, 5});
+    gs.stacks[2].forceCard({Color::Heart, 1});
+    gs.stacks[2].forceCard({Color::Club, 9});
+    gs.stacks[3].forceCard({Color::Diamond, 4});
+    for (int i = 4; i < nb_stacks; ++i)
+        gs.stacks[i].forceCard({Color::Club, 6 + i});
+    gs.free_cells[0].acceptCard({Color::Spade, 12});
+
+    PackedMove last(first_stack_slot + 3, 1);
+    REQUIRE(slotMoveLegal(gs, last.from(), last.to()));
+    slotMove(gs, last.from(), last.to());
+
+    SECTION("Independent move from a lower slot") {
+        REQUIRE(isCommutedMove(gs, PackedMove(first_stack_slot, 2), last));
+        REQUIRE(isCommutedMove(gs, PackedMove(first_stack_slot + 1, first_stack_slot), last));
+        REQUIRE_FALSE(isCommutedMove(gs, PackedMove(first_stack_slot + 4, 2), last));
+    }
+
+    SECTION("Moves sharing a storage or going home") {
+        REQUIRE_FALSE(isCommutedMove(gs, PackedMove(first_stack_slot, 1), last));
+        REQUIRE_FALSE(isCommutedMove(gs, PackedMove(1, first_stack_slot + 3), last));
+        REQUIRE_FALSE(isCommutedMove(gs, PackedMove(first_stack_slot, first_stack_slot + 3), last));
+    }
+
+    SECTION("Uncovering a card safe to go home") {
+        REQUIRE_FALSE(isCommutedMove(gs, PackedMove(first_stack_slot + 2, 2), last));
+    }
+
+    SECTION("Generated only in one order") {
+        GameState before;
+        before.stacks = gs.stacks;
+        before.free_cells = gs.free_cells;
+        before.stacks[3].forceCard(*before.free_cells[1].getCard());
+
+        MoveOptions options;
+        options.por = true;
+        SearchState state(before, options);
+        MoveBuffer moves;
+        SearchAction(last).execute(state).actions(moves);
+        REQUIRE(std::find(moves.begin(), moves.end(), PackedMove(first_stack_slot, 2)) == moves.end());
+
+        PackedMove lower(first_stack_slot, 2);
+        SearchAction(lower).execute(state).actions(moves);
+        REQUIRE(std::find(moves.begin(), moves.end(), PackedMove(last.from(), 1)) != moves.end());
+    }
+}
+
+TEST_CASE("External BFS with partial-order reduction solves like BFS") {
+    MoveOptions options;
+    options.por = true;
+    const size_t mem_limit = size_t{256} << 20;
+
+    EasyProducer producer(5, 25);
+    for (int i = 0; i < 10; ++i) {
+        SearchState init_state(producer.produce(), options);
+        auto expected = BreadthFirstSearch(mem_limit).solve(init_state);
+        auto solution = ExternalBreadthFirstSearch(mem_limit, "").solve(init_state);
+        REQUIRE(solution.size() == expected.size());
+
+        SearchState state(init_state);
+        for (const auto &action : solution)
+            state = action.execute(state);
+        REQUIRE(state.isFinal());
+    }
+}
+
+TEST_CASE("Dead ends") {
+    GameState gs;
+    gs.free_cells[0].acceptCard({Color::Diamond, 13});
+    gs.free_cells[1].acceptCard({Color::Heart, 13});
+    gs.free_cells[2].acceptCard({Color::Diamond, 3});
+    gs.free_cells[3].acceptCard({Color::Heart, 3});
+    for (int i = 0; i < nb_stacks; ++i)
+        gs.stacks[i].forceCard({i % 2 ? Color::Club : Color::Spade, 13 - i});
+
+    SECTION("No legal move") {
+        REQUIRE(isDeadEnd(gs, 0));
+        REQUIRE_FALSE(SearchState(gs).isDeadEnd());
+
+        MoveOptions options;
+        options.dead_end_depth = 0;
+        unsigned long long nb_dead_ends_before = SearchState::nbDeadEnds();
+        REQUIRE(SearchState(gs, options).isDeadEnd());
+        REQUIRE(SearchState::nbDeadEnds() == nb_dead_ends_before + 1);
+    }
+
+    SECTION("Empty free cell") {
+        gs.free_cells[3].getCard();
+        REQUIRE_FALSE(isDeadEnd(gs, 5));
+    }
+
+    SECTION("Card for the homes uncovered") {
+        gs.stacks[7].forceCard({Color::Club, 1});
+        REQUIRE_FALSE(isDeadEnd(gs, 5));
+    }
+
+    SECTION("Every move leads to a position without moves") {
+        gs.stacks[7].getCard();
+        gs.stacks[7].forceCard({Color::Club, 2});
+        gs.stacks[7].forceCard({Color::Diamond, 6});
+
+        REQUIRE_FALSE(isDeadEnd(gs, 0));
+        REQUIRE(isDeadEnd(gs, 1));
+        REQUIRE(isDeadEnd(gs, 5));
+    }
+}
+
+TEST_CASE("Pattern database") {
+    SECTION("Distances of a small pattern") {
+        PatternSpec spec{1, 2};
+        REQUIRE(spec.tableSize() == 16);
+        auto table = computePatternTable(spec);
+
+        // places in base 4: home, aside, on the ace, on the two
+        auto at = [&](int ace, int two) {return table[ace + 4 * two];};
+        REQUIRE(at(0, 0) == 0);
+        REQUIRE(at(0, 1) == 1);
+        REQUIRE(at(1, 1) == 2);
+        REQUIRE(at(3, 1) == 2);
+        REQUIRE(at(1, 2) == 3);
+        REQUIRE(at(3, 2) == 255);
+        REQUIRE(at(1, 0) == 255);
+    }
+
+    PatternDatabaseHeuristic pdb;
+    OufOfHome_Pseudo out_of_home;
+    GameState gs;
+
+    SECTION("Cards to put aside first") {
+        gs.stacks[0].forceCard({Color::Heart, 1});
+        gs.stacks[0].forceCard({Color::Spade, 9});
+        gs.stacks[0].forceCard({Color::Heart, 4});
+        gs.stacks[1].forceCard({Color::Heart, 9});
+        gs.stacks[1].forceCard({Color::Heart, 12});
+        gs.stacks[1].forceCard({Color::Heart, 7});
+        REQUIRE(out_of_home.distanceLowerBound(gs) == 52);
+        REQUIRE(pdb.distanceLowerBound(gs) == 52 + 2);
+
+        gs.homes[0].acceptCard({Color::Heart, 1});
+        gs.stacks[0] = WorkStack();
+        REQUIRE(pdb.distanceLowerBound(gs) == 51 + 1);
+    }
+
+    SECTION("Saved and mapped again") {
+        // removed however the section ends
+        struct TempFile {
+            std::string path = (std::filesystem::temp_directory_path() / "fc-sui-pdb-test.bin").string();
+            ~TempFile() {std::remove(path.c_str());}
+        } file;
+        {
+            PatternDatabaseHeuristic saved(file.path);
+        }
+        PatternDatabaseHeuristic mapped(file.path);
+
+        for (int seed = 0; seed < 20; ++seed) {
+            GameState deal = RandomProducer(seed).produce();
+            REQUIRE(mapped.distanceLowerBound(deal) == pdb.distanceLowerBound(deal));
+            REQUIRE(pdb.distanceLowerBound(deal) >= out_of_home.distanceLowerBound(deal));
+        }
+    }
+}